@@ -0,0 +1,47 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#ifndef ARENA_H_
+#define ARENA_H_
+#include <stddef.h>
+
+typedef struct _ArenaChunk *ArenaChunk;
+struct _ArenaChunk {
+  ArenaChunk next;
+  size_t size;
+  size_t used;
+};
+
+/*
+ * Memory arena: blocks are carved from large chunks and are all released at
+ * once by arena_reset(). A zeroed arena is a valid empty arena. The counters
+ * compare the blocks served to the chunks actually allocated.
+ */
+typedef struct _Arena *Arena;
+struct _Arena {
+  const char *name;
+  ArenaChunk chunks;
+  size_t used;
+  size_t peak;
+
+  long nblocks;
+  double block_bytes;
+  long nchunks;
+  double chunk_bytes;
+};
+
+void *arena_alloc(Arena arena, size_t size);
+void arena_reset(Arena arena);
+void arena_free(Arena arena);
+void arena_report(Arena arena);
+
+/* Scheduling state of a candidate schedule, released after its evaluation */
+extern struct _Arena schedule_arena;
+/* Scheduling state of a DAG, released when the DAG is freed */
+extern struct _Arena dag_arena;
+
+#endif /* ARENA_H_ */
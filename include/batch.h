@@ -0,0 +1,29 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#ifndef BATCH_H_
+#define BATCH_H_
+
+/* A (platform, DAG) pair read from a batch manifest */
+typedef struct _BatchJob *BatchJob;
+struct _BatchJob {
+  char *platform_file;
+  char *dagfile;
+  int done;
+};
+
+int read_batch_manifest(const char *file, BatchJob *jobs);
+void free_batch_jobs(int njobs, BatchJob jobs);
+
+void run_platform_jobs(int njobs, BatchJob jobs, int first);
+int run_platform_jobs_in_parallel(int njobs, BatchJob jobs, int first,
+    int nworkers, char *directory);
+void run_batch(const char *manifest);
+
+extern int batch_nworkers;
+
+#endif /* BATCH_H_ */
@@ -8,14 +8,61 @@
 #ifndef BICPA_H_
 #define BICPA_H_
 
+/* Number of intervals of the utilization profile of a schedule */
+#define UTILIZATION_BINS 10
+
 typedef struct _SchedInfo {
   int nworkstations;
   double makespan;
   double work;
   int peak_allocation;
+  /* Makespan estimated by map_allocations(), before any simulation */
+  double estimated_makespan;
+  /*
+   * Utilization profile, only computed with --utilization: peak number of
+   * workstations busy at the same time, idle area of these workstations
+   * during the makespan, and their utilization (in percent) over time.
+   */
+  int concurrent_peak;
+  double idle_area;
+  double utilization[UTILIZATION_BINS];
 } *Sched_info_t;
 
+/*
+ * Results of biCPA for a DAG: the schedule results for the 'nschedules'
+ * evaluated sizes of the target cluster (all of them, unless screening is
+ * used), in the order they are displayed, the sizes selected by the four
+ * variants, and the time spent to build the allocations and to map and
+ * simulate the schedules. 'nworkstations' is the size of the whole cluster.
+ */
+typedef struct _BiCPAResult {
+  int nworkstations;
+  int nschedules;
+  Sched_info_t *siList;
+  int best_makespan_nworkstations;
+  int best_work_nworkstations;
+  int perfect_equity_nworkstations;
+  int min_sum_nworkstations;
+  double alloc_time;
+  double mapping_time;
+} *BiCPA_result_t;
+
+Sched_info_t new_sched_info(int nworkstations, double makespan, double work,
+                            int peak_allocation);
+Sched_info_t copy_sched_info(int nworkstations, Sched_info_t s);
+
+BiCPA_result_t compute_biCPA(xbt_dynar_t dag);
+void print_biCPA_result(BiCPA_result_t r);
+void free_biCPA_result(BiCPA_result_t r);
+void set_selected_allocations(xbt_dynar_t dag, BiCPA_result_t r);
 void schedule_with_biCPA(xbt_dynar_t dag);
 
+extern int nthreads;
+extern double screening_distance;
+extern int verify_screening_results;
+extern double sampling_threshold;
+extern int utilization_profile;
+extern int mcpa_allocation;
+
 
 #endif /* BICPA_H_ */
@@ -8,20 +8,27 @@
 #ifndef DAG_H_
 #define DAG_H_
 
+xbt_dynar_t load_dag(const char *file);
+void free_dag(xbt_dynar_t dag);
+
 SD_task_t get_dag_root(xbt_dynar_t dag);
 SD_task_t get_dag_end(xbt_dynar_t dag);
 
 void set_bottom_levels (xbt_dynar_t dag);
+void update_bottom_levels (SD_task_t task);
 void set_top_levels (xbt_dynar_t dag);
 void set_precedence_levels (xbt_dynar_t dag);
 
 double compute_total_work (xbt_dynar_t dag);
+int compute_utilization_profile(int nbins, double makespan,
+    double *utilization, double *busy_area);
 
 void set_allocations_from_iteration(xbt_dynar_t dag, int index);
-void map_allocations(xbt_dynar_t dag);
+double map_allocations(xbt_dynar_t dag);
 void reset_simulation (xbt_dynar_t dag);
 
 extern int with_communications;
+extern int backfilling;
 extern char* dagfile;
 
 char* basename (char*);
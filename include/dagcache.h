@@ -0,0 +1,21 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#ifndef DAGCACHE_H_
+#define DAGCACHE_H_
+#include "simdag/simdag.h"
+#include "graph.h"
+
+/* Suffix added to the name of a DOT file to get that of its binary form */
+#define DAG_CACHE_SUFFIX ".bdag"
+
+xbt_dynar_t dag_cache_load(const char *file, Graph *g);
+int convert_dag(const char *file, const char *binary_file);
+
+extern int dag_cache;
+
+#endif /* DAGCACHE_H_ */
@@ -0,0 +1,49 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#ifndef DOT_H_
+#define DOT_H_
+#include <stddef.h>
+#include <stdint.h>
+#include "simdag/simdag.h"
+#include "graph.h"
+
+/*
+ * DAG as read from a file, before the creation of its SimDag tasks. Nodes are
+ * numbered from 0 in their order of appearance, and have an amount of
+ * computation and a non-parallelizable fraction. Edges are given by their
+ * source and destination nodes and their amount of data, 0 for control
+ * dependencies.
+ */
+typedef struct _DagDescription *DagDescription;
+struct _DagDescription {
+  int nnodes;
+  char **names;
+  double *amounts;
+  double *alphas;
+
+  int nedges;
+  int *sources;
+  int *destinations;
+  double *sizes;
+};
+
+int map_file(const char *file, char **content, size_t *size);
+void unmap_file(char *content, size_t size);
+uint64_t hash_content(const char *content, size_t size);
+int hash_file(const char *file, uint64_t *hash);
+
+double dot_parse_content(const char *file, const char *content, size_t size,
+    DagDescription d);
+xbt_dynar_t dag_description_load(DagDescription d, Graph *g);
+void dag_description_free(DagDescription d);
+
+xbt_dynar_t fast_dotload(const char *file, Graph *g);
+
+extern int fast_dot_parser;
+
+#endif /* DOT_H_ */
@@ -0,0 +1,97 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#ifndef GRAPH_H_
+#define GRAPH_H_
+#include "simdag/simdag.h"
+#include "task.h"
+
+/*
+ * Compact view of a DAG built once after its loading. Each task is given an
+ * integer identifier: compute tasks are numbered from 0 ('root') to
+ * ncompute-1 ('end'), transfer tasks come after them. Edges between compute
+ * tasks, either flow or control dependencies, are stored in compressed sparse
+ * row format in both directions: the neighbors of compute task 'i' are found
+ * between index[i] and index[i+1]-1 in the corresponding arrays. For each edge
+ * the amount of data and the transfer task are kept. Control dependencies have
+ * no transfer task (NULL) and no data.
+ */
+typedef struct _Graph *Graph;
+struct _Graph {
+  int ntasks;
+  int ncompute;
+  int root;
+  int end;
+
+  SD_task_t *tasks;
+  /* Attributes of all the tasks, stored contiguously */
+  struct _TaskAttribute *attributes;
+
+  int *child_index;
+  int *children;
+  double *child_sizes;
+  SD_task_t *child_transfers;
+
+  int *parent_index;
+  int *parents;
+  double *parent_sizes;
+  SD_task_t *parent_transfers;
+
+  /*
+   * Coefficients of Amdahl's law for the compute tasks, stored as structure of
+   * arrays. The execution time on n workstations of compute task 'i' is
+   * (alpha[i] + parallel_fraction[i]/n) * sequential_time[i].
+   */
+  double *alpha;
+  double *parallel_fraction;
+  double *sequential_time;
+
+  /* Rank of the compute tasks in a topological order of the DAG */
+  int *rank;
+
+  /*
+   * Compute tasks whose bottom level has been modified by the last call to
+   * update_bottom_levels(). A task is recorded once per call, which is
+   * checked by comparing its stamp to that of the call.
+   */
+  int nupdated;
+  int *updated;
+  int *update_stamps;
+  int update_stamp;
+
+  /*
+   * Bottom levels of the compute tasks allocated on a single workstation, as
+   * set after loading, to restore the initial state of the allocation
+   * procedure without traversing the DAG.
+   */
+  double *initial_bottom_levels;
+
+  /*
+   * Resource dependencies added by map_allocations() for the current schedule,
+   * as (parent, child) pairs of compute task identifiers, so that
+   * reset_simulation() only removes them.
+   */
+  int nresource_edges;
+  int resource_edges_size;
+  int *resource_edges;
+
+  /* Work arrays of 'ncompute' elements used by traversals and estimations */
+  int *scratch;
+  double *estimates;
+};
+
+Graph graph_new(xbt_dynar_t dag);
+Graph graph_new_from_edges(xbt_dynar_t dag, int nedges, const int *sources,
+    const int *destinations, const double *sizes, SD_task_t *transfers);
+void graph_free(Graph g);
+void graph_save_initial_state(Graph g);
+void graph_restore_initial_state(Graph g);
+void graph_add_resource_edge(Graph g, int parent, int child);
+
+extern Graph graph;
+
+#endif /* GRAPH_H_ */
@@ -0,0 +1,47 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#ifndef PATH_H_
+#define PATH_H_
+
+/*
+ * Critical path of the DAG, as browsed by the allocation procedure of CPA:
+ * starting from 'root', the next task is the compute child with the biggest
+ * bottom level (the first one in case of ties), until 'end' is reached.
+ * The path is stored as a doubly linked list of task identifiers. The tasks of
+ * the path that can benefit from an extra workstation are kept in a binary
+ * max-heap ordered by decreasing gains, ties being broken by the position on
+ * the path, i.e., by increasing topological ranks.
+ */
+typedef struct _CriticalPath *CriticalPath;
+struct _CriticalPath {
+  int nworkstations;
+
+  /* Whether a task is on the path, and its neighbors on it (-1 if none) */
+  int *on_path;
+  int *next;
+  int *previous;
+
+  /* Gains of the tasks, and heap of the tasks with a positive gain */
+  double *gains;
+  int nheap;
+  int *heap;
+  int *heap_position;
+
+  /* Tasks of the path whose successor on the path may have changed */
+  int naffected;
+  int *affected;
+  int *is_affected;
+};
+
+CriticalPath critical_path_new(int nworkstations);
+void critical_path_free(CriticalPath path);
+
+int critical_path_get_best_task(CriticalPath path);
+void critical_path_update(CriticalPath path, int selected_task);
+
+#endif /* PATH_H_ */
@@ -0,0 +1,23 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#ifndef RESULTCACHE_H_
+#define RESULTCACHE_H_
+#include "bicpa.h"
+
+void result_cache_init(void);
+BiCPA_result_t result_cache_fetch(const char *platform_file,
+    const char *dagfile);
+int result_cache_lookup(const char *platform_file, const char *dagfile);
+void result_cache_store(const char *platform_file, const char *dagfile,
+    BiCPA_result_t r);
+void result_cache_report(void);
+
+extern char *cache_dir;
+extern double cache_size;
+
+#endif /* RESULTCACHE_H_ */
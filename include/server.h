@@ -0,0 +1,16 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#ifndef SERVER_H_
+#define SERVER_H_
+
+void run_server(const char *socket_path);
+int send_request(const char *socket_path, const char *request);
+
+extern char *server_socket;
+
+#endif /* SERVER_H_ */
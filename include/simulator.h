@@ -0,0 +1,31 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#ifndef SIMULATOR_H_
+#define SIMULATOR_H_
+#include "simdag/simdag.h"
+
+/* Simulation engines that can be used to evaluate a schedule */
+#define SIMGRID_SIMULATOR 0
+#define NATIVE_SIMULATOR  1
+/* No simulation: the makespan is the estimate made while mapping the tasks */
+#define ESTIMATE_ONLY     2
+
+double simulate_with_simgrid(xbt_dynar_t dag);
+double simulate_natively(xbt_dynar_t dag);
+double simulate_makespan(xbt_dynar_t dag);
+void report_simgrid_sequencing();
+double get_simgrid_start_clock();
+
+int native_engine_is_used();
+int simgrid_engine_is_used();
+int simgrid_gives_makespan();
+
+extern int simulator;
+extern double cross_validation_tolerance;
+
+#endif /* SIMULATOR_H_ */
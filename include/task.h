@@ -11,6 +11,9 @@
 
 typedef struct _TaskAttribute *TaskAttribute;
 struct _TaskAttribute {
+  /* Identifier of the task in the compact view of the DAG */
+  int id;
+
   double bottom_level;
   double top_level;
   int precedence_level;
@@ -18,9 +21,21 @@ struct _TaskAttribute {
   /* The workstations onto which the node has been scheduled */
   int allocation_size;
   SD_workstation_t *allocation;
-
-  int *iterative_allocations;
-
+  /* Same set of workstations, as a bitset indexed by workstation identifiers */
+  unsigned long *allocation_bitset;
+
+  /*
+   * Allocations determined for the assumed sizes of the target cluster. As
+   * they only grow with the assumed size, only the sizes where they change are
+   * stored, in increasing order: the allocation for size 'n' is that of the
+   * last change point not larger than 'n'. Only allocated for compute tasks.
+   */
+  int nchanges;
+  int changes_size;
+  int *change_nworkstations;
+  int *change_allocations;
+
+  double estimated_start_time;
   double estimated_finish_time;
 
   int marked;
@@ -31,9 +46,11 @@ struct _TaskAttribute {
 /**************          Attribute management functions         **************/
 /*****************************************************************************/
 /*****************************************************************************/
-void SD_task_allocate_attribute(SD_task_t);
+void SD_task_allocate_attribute(SD_task_t, TaskAttribute attr, int id);
 void SD_task_free_attribute(SD_task_t);
 
+int SD_task_get_id(SD_task_t task);
+
 double SD_task_get_bottom_level(SD_task_t task);
 void SD_task_set_bottom_level(SD_task_t task, double bottom_level);
 
@@ -52,6 +69,9 @@ void SD_task_set_allocation(SD_task_t task, SD_workstation_t *workstation_list);
 int SD_task_get_iterative_allocations (SD_task_t task, int index);
 void SD_task_set_iterative_allocations (SD_task_t task, int index, int size);
 
+double SD_task_get_estimated_start_time(SD_task_t task);
+void SD_task_set_estimated_start_time(SD_task_t task, double start_time);
+
 double SD_task_get_estimated_finish_time(SD_task_t task);
 void SD_task_set_estimated_finish_time(SD_task_t task, double finish_time);
 
@@ -61,6 +81,7 @@ void SD_task_set_estimated_finish_time(SD_task_t task, double finish_time);
 /*****************************************************************************/
 /*****************************************************************************/
 int bottomLevelCompareTasks(const void *, const void *);
+int startTimeCompareTasks(const void *, const void *);
 
 /*****************************************************************************/
 /*****************************************************************************/
@@ -78,10 +99,18 @@ void SD_task_unmark(SD_task_t task);
 /*****************************************************************************/
 double SD_task_estimate_execution_time(SD_task_t task, int nworkstations);
 double SD_task_estimate_area(SD_task_t task, int nworkstations);
+void SD_task_estimate_execution_times(int count, const int *ids, const int *n,
+    double *times);
+void SD_task_estimate_areas(int count, const int *ids, const int *n,
+    double *areas);
+void SD_task_estimate_gains(int count, const int *ids, const int *n,
+    double *gains);
 double SD_task_estimate_minimal_start_time(SD_task_t task);
 double SD_task_estimate_transfer_time_from(SD_task_t src, SD_task_t dst,
     double size);
 double SD_task_estimate_last_data_arrival_time (SD_task_t task);
+double SD_task_estimate_redistribution_time(int id, int edge);
+double SD_task_estimate_child_bottom_level(int id, int edge);
 
 /*****************************************************************************/
 /*****************************************************************************/
@@ -89,6 +118,7 @@ double SD_task_estimate_last_data_arrival_time (SD_task_t task);
 /*****************************************************************************/
 /*****************************************************************************/
 double bottom_level_recursive_computation(SD_task_t task);
+double bottom_level_local_computation(SD_task_t task);
 double top_level_recursive_computation(SD_task_t task);
 int precedence_level_recursive_computation(SD_task_t task);
 
@@ -11,26 +11,50 @@
 
 typedef struct _WorkstationAttribute *WorkstationAttribute;
 struct _WorkstationAttribute {
+  /* Index of the workstation in the list sorted by name */
+  int id;
   /* Earliest time at which a workstation is ready to execute a task*/
   double available_at;
   /* To keep track of potential resource dependencies */
   SD_task_t last_scheduled_task;
 };
 
+/*
+ * Summary of the route between two workstations, as needed to estimate
+ * transfer times: bandwidths of the first and last links, bottleneck bandwidth
+ * of the links in between (0 if there is none), and latency of the route.
+ */
+typedef struct _RouteSummary *RouteSummary;
+struct _RouteSummary {
+  int nlinks;
+  double first_bandwidth;
+  double middle_bandwidth;
+  double last_bandwidth;
+  double latency;
+};
+
 /*****************************************************************************/
 /*****************************************************************************/
 /**************          Attribute management functions         **************/
 /*****************************************************************************/
 /*****************************************************************************/
-void SD_workstation_allocate_attribute(SD_workstation_t );
+void load_platform(const char *file);
+void free_platform();
+
+void SD_workstation_allocate_attribute(SD_workstation_t, int id);
 void SD_workstation_free_attribute(SD_workstation_t );
 
+int SD_workstation_get_id(SD_workstation_t);
+
 double SD_workstation_get_available_at(SD_workstation_t);
 void SD_workstation_set_available_at(SD_workstation_t, double);
 SD_task_t SD_workstation_get_last_scheduled_task( SD_workstation_t workstation);
 void SD_workstation_set_last_scheduled_task(SD_workstation_t workstation,
                                             SD_task_t task);
 void reset_workstation_attributes();
+void restore_workstation_attributes();
+void build_availability_index();
+void free_availability_index();
 
 /*****************************************************************************/
 /*****************************************************************************/
@@ -38,8 +62,6 @@ void reset_workstation_attributes();
 /*****************************************************************************/
 /*****************************************************************************/
 int nameCompareWorkstations(const void *, const void *);
-int availableAtCompareWorkstations(const void *n1, const void *n2);
-int NavailableAtCompareWorkstations(const void *n1, const void *n2);
 
 /*****************************************************************************/
 /*****************************************************************************/
@@ -48,12 +70,29 @@ int NavailableAtCompareWorkstations(const void *n1, const void *n2);
 /*****************************************************************************/
 int compute_peak_resource_usage();
 
+/*****************************************************************************/
+/*****************************************************************************/
+/**************                   Route cache                   **************/
+/*****************************************************************************/
+/*****************************************************************************/
+void build_route_cache();
+void free_route_cache();
+RouteSummary get_route_summary(int src, int dst);
+
 
 
-SD_workstation_t * get_best_workstation_set(double time);
+SD_workstation_t * get_best_workstation_set(double time, int nworkstations);
 double get_best_workstation_set_earliest_availability(int nworkstations,
     SD_workstation_t * workstations);
 
+void reset_gap_index();
+void free_gap_index();
+SD_workstation_t *get_backfilling_workstation_set(double time,
+    int nworkstations, double duration, double *start, int *in_gaps);
+void backfill_workstation_set(SD_task_t task, int nworkstations,
+    SD_workstation_t *workstations, double start, double finish,
+    SD_task_t *before, SD_task_t *after);
+
 extern char* platform_file;
 
 #endif /* WORKSTATION_H_ */
@@ -0,0 +1,111 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "xbt.h"
+#include "arena.h"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(arena, biCPA, "Logging specific to arenas");
+
+/* Blocks are aligned on 16 bytes, and chunks hold at least 64 KiB */
+#define ARENA_ALIGNMENT  16
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN(size) \
+  (((size) + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1))
+#define ARENA_HEADER_SIZE ARENA_ALIGN(sizeof(struct _ArenaChunk))
+
+struct _Arena schedule_arena = { "schedule", NULL, 0, 0, 0, 0., 0, 0. };
+struct _Arena dag_arena = { "DAG", NULL, 0, 0, 0, 0., 0, 0. };
+
+static ArenaChunk arena_new_chunk(Arena arena, size_t size){
+  ArenaChunk chunk = (ArenaChunk) malloc (ARENA_HEADER_SIZE + size);
+
+  xbt_assert(chunk, "Cannot allocate %zu bytes for arena '%s'", size,
+      arena->name);
+  chunk->size = size;
+  chunk->used = 0;
+  chunk->next = arena->chunks;
+  arena->chunks = chunk;
+  arena->nchunks++;
+  arena->chunk_bytes += size;
+  return chunk;
+}
+
+/*
+ * Return a zeroed block of 'size' bytes from the current chunk of the arena.
+ * When it is full, a new chunk, twice as large as the current one at least, is
+ * allocated. The remaining space of the former chunk is lost until the next
+ * reset.
+ */
+void *arena_alloc(Arena arena, size_t size){
+  ArenaChunk chunk = arena->chunks;
+  void *block;
+
+  size = ARENA_ALIGN(size);
+  if (!chunk || chunk->used + size > chunk->size)
+    chunk = arena_new_chunk(arena, MAX(MAX(size, ARENA_CHUNK_SIZE),
+        chunk ? 2 * chunk->size : 0));
+
+  block = (char*) chunk + ARENA_HEADER_SIZE + chunk->used;
+  chunk->used += size;
+  arena->used += size;
+  arena->peak = MAX(arena->peak, arena->used);
+  arena->nblocks++;
+  arena->block_bytes += size;
+  memset(block, 0, size);
+  return block;
+}
+
+/*
+ * Release all the blocks of the arena. If several chunks were needed, they are
+ * replaced by a single chunk as large as all of them, so that the next uses of
+ * the arena, that are usually similar, fit in it.
+ */
+void arena_reset(Arena arena){
+  size_t size = 0;
+  ArenaChunk chunk, next;
+
+  if (!arena->chunks)
+    return;
+  if (arena->chunks->next){
+    for (chunk = arena->chunks; chunk; chunk = next){
+      next = chunk->next;
+      size += chunk->size;
+      free(chunk);
+    }
+    arena->chunks = NULL;
+    arena_new_chunk(arena, size);
+  }
+  arena->chunks->used = 0;
+  arena->used = 0;
+}
+
+/*
+ * Release all the chunks of the arena, which remains a valid empty arena.
+ */
+void arena_free(Arena arena){
+  ArenaChunk chunk, next;
+
+  for (chunk = arena->chunks; chunk; chunk = next){
+    next = chunk->next;
+    free(chunk);
+  }
+  arena->chunks = NULL;
+  arena->used = 0;
+}
+
+/*
+ * Report the blocks served by the arena, i.e., the allocations that would have
+ * been made one by one without it, and the chunks it actually allocated.
+ */
+void arena_report(Arena arena){
+  XBT_VERB("Arena '%s': %ld blocks (%.1f MB) served by %ld allocations "
+      "(%.1f MB), peak usage %.1f KB", arena->name, arena->nblocks,
+      arena->block_bytes / 1e6, arena->nchunks, arena->chunk_bytes / 1e6,
+      arena->peak / 1e3);
+}
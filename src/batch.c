@@ -0,0 +1,428 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "simdag/simdag.h"
+#include "xbt.h"
+
+#include "batch.h"
+#include "bicpa.h"
+#include "dag.h"
+#include "resultcache.h"
+#include "workstation.h"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(batch, biCPA, "Logging specific to batch mode");
+
+/*
+ * Read a batch manifest. Each line gives a platform file and a DAG file,
+ * separated by blanks. Empty lines and lines starting with '#' are ignored.
+ * The jobs are stored in '*jobs' in the order of the manifest, and their
+ * number is returned.
+ */
+int read_batch_manifest(const char *file, BatchJob *jobs){
+  int njobs = 0, nallocated = 0, line_number = 0;
+  char line[4096], *platform, *dag;
+  FILE *manifest = fopen(file, "r");
+
+  xbt_assert(manifest, "Cannot open batch manifest '%s'", file);
+  *jobs = NULL;
+
+  while (fgets(line, sizeof(line), manifest)){
+    line_number++;
+    platform = strtok(line, " \t\r\n");
+    if (!platform || platform[0] == '#')
+      continue;
+    dag = strtok(NULL, " \t\r\n");
+    xbt_assert(dag, "%s:%d: a DAG file is expected after '%s'", file,
+        line_number, platform);
+
+    if (njobs == nallocated){
+      nallocated = nallocated ? 2 * nallocated : 64;
+      *jobs = (BatchJob) realloc (*jobs, nallocated * sizeof(struct _BatchJob));
+    }
+    (*jobs)[njobs].platform_file = strdup(platform);
+    (*jobs)[njobs].dagfile = strdup(dag);
+    (*jobs)[njobs].done = 0;
+    njobs++;
+  }
+  fclose(manifest);
+
+  return njobs;
+}
+
+void free_batch_jobs(int njobs, BatchJob jobs){
+  int i;
+
+  for (i = 0; i < njobs; i++){
+    free(jobs[i].platform_file);
+    free(jobs[i].dagfile);
+  }
+  free(jobs);
+}
+
+/*
+ * Load the platform of job 'first' and schedule the DAGs of all the jobs that
+ * target this platform, in the order of the manifest. The platform is thus
+ * parsed once, while the DAGs are loaded and destroyed one after the other.
+ */
+void run_platform_jobs(int njobs, BatchJob jobs, int first){
+  int i;
+  xbt_dynar_t dag;
+
+  platform_file = jobs[first].platform_file;
+  load_platform(platform_file);
+
+  for (i = first; i < njobs; i++){
+    if (strcmp(jobs[i].platform_file, jobs[first].platform_file))
+      continue;
+    XBT_VERB("Schedule '%s' on '%s'", jobs[i].dagfile, platform_file);
+    dagfile = jobs[i].dagfile;
+    if (result_cache_lookup(platform_file, dagfile))
+      continue;
+    dag = load_dag(dagfile);
+    schedule_with_biCPA(dag);
+    free_dag(dag);
+  }
+
+  free_platform();
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************            Work-stealing pool of workers        **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/* States of the jobs of a pool */
+#define JOB_PENDING 0
+#define JOB_DONE    1
+#define JOB_FAILED  2
+
+/*
+ * Pool of workers that schedule the jobs of a platform concurrently. As
+ * SimGrid runs a single simulation engine per process, the workers are forked
+ * processes, that each load the platform once and hold their own scheduling
+ * state. All the arrays below are shared between the parent and the workers.
+ * Jobs are numbered in the order of the manifest, and 'jobs' gives their
+ * indexes in the manifest. Each worker owns a deque of jobs, i.e., the jobs
+ * between head[w] and tail[w]-1, initially a contiguous block of jobs. A worker takes
+ * the jobs of its deque from the head. When it is empty, it steals the job at
+ * the tail of the deque that has the most jobs left. Deques are protected by
+ * spin locks. The output of each job is written in a file of its own, and the
+ * parent prints these files in the order of the jobs.
+ */
+typedef struct _JobPool *JobPool;
+struct _JobPool {
+  int njobs;
+  int nworkers;
+  char *directory;
+
+  /* Indexes of the jobs in the manifest, and bounds of the deques */
+  int *jobs;
+  int *head;
+  int *tail;
+  int *locks;
+
+  /* State of each job, and job being run by each worker (-1 if none) */
+  int *states;
+  int *running;
+  pid_t *workers;
+};
+
+static void *shared_calloc(int nmemb, size_t size){
+  void *ptr = mmap(NULL, nmemb * size, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  xbt_assert(ptr != MAP_FAILED, "Cannot allocate memory shared with workers");
+  return ptr;
+}
+
+static void pool_lock(JobPool pool, int w){
+  while (__sync_lock_test_and_set(&(pool->locks[w]), 1))
+    ;
+}
+
+static void pool_unlock(JobPool pool, int w){
+  __sync_lock_release(&(pool->locks[w]));
+}
+
+/* Take the job at the head of the deque of worker 'w' (-1 if empty) */
+static int pool_pop(JobPool pool, int w){
+  int job = -1;
+
+  pool_lock(pool, w);
+  if (pool->head[w] < pool->tail[w])
+    job = pool->head[w]++;
+  pool_unlock(pool, w);
+  return job;
+}
+
+/* Steal the job at the tail of the fullest deque of the other workers */
+static int pool_steal(JobPool pool, int w){
+  int v, victim, nleft, job;
+
+  do {
+    victim = -1;
+    nleft = 0;
+    for (v = 0; v < pool->nworkers; v++)
+      if (v != w && pool->tail[v] - pool->head[v] > nleft){
+        victim = v;
+        nleft = pool->tail[v] - pool->head[v];
+      }
+    if (victim < 0)
+      return -1;
+
+    job = -1;
+    pool_lock(pool, victim);
+    if (pool->head[victim] < pool->tail[victim])
+      job = --pool->tail[victim];
+    pool_unlock(pool, victim);
+  } while (job < 0);
+
+  XBT_DEBUG("Worker %d steals job %d from worker %d", w, job, victim);
+  return job;
+}
+
+static char *get_job_output(JobPool pool, int k){
+  return bprintf("%s/%d.out", pool->directory, k);
+}
+
+/*
+ * Schedule one job of the pool, with the standard output redirected to the
+ * output file of the job.
+ */
+static void pool_run_job(JobPool pool, BatchJob jobs, int k){
+  int fd, saved_stdout;
+  char *output = get_job_output(pool, k);
+  xbt_dynar_t dag;
+
+  fflush(stdout);
+  saved_stdout = dup(STDOUT_FILENO);
+  fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  xbt_assert(fd >= 0, "Cannot create output file '%s'", output);
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+
+  dagfile = jobs[pool->jobs[k]].dagfile;
+  XBT_VERB("Schedule '%s' on '%s'", dagfile, platform_file);
+  if (!result_cache_lookup(platform_file, dagfile)){
+    dag = load_dag(dagfile);
+    schedule_with_biCPA(dag);
+    free_dag(dag);
+  }
+
+  fflush(stdout);
+  dup2(saved_stdout, STDOUT_FILENO);
+  close(saved_stdout);
+  free(output);
+}
+
+static void pool_worker(JobPool pool, BatchJob jobs, int w){
+  int k;
+
+  platform_file = jobs[pool->jobs[0]].platform_file;
+  load_platform(platform_file);
+
+  while ((k = pool_pop(pool, w)) >= 0 || (k = pool_steal(pool, w)) >= 0){
+    pool->running[w] = k;
+    pool_run_job(pool, jobs, k);
+    __sync_synchronize();
+    pool->states[k] = JOB_DONE;
+    pool->running[w] = -1;
+  }
+
+  free_platform();
+  fflush(stdout);
+  _exit(0);
+}
+
+static void pool_start_worker(JobPool pool, BatchJob jobs, int w){
+  fflush(stdout);
+  fflush(stderr);
+  pool->workers[w] = fork();
+  xbt_assert(pool->workers[w] >= 0, "Cannot fork worker %d", w);
+  if (!pool->workers[w])
+    pool_worker(pool, jobs, w);
+}
+
+/* Print the output file of a job, then remove it */
+static void pool_print_job(JobPool pool, BatchJob jobs, int k){
+  char buffer[4096], *output = get_job_output(pool, k);
+  size_t n;
+  FILE *f;
+
+  if (pool->states[k] == JOB_DONE && (f = fopen(output, "r"))){
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+      fwrite(buffer, 1, n, stdout);
+    fclose(f);
+  } else {
+    XBT_WARN("No result for '%s' on '%s'", jobs[pool->jobs[k]].dagfile,
+        jobs[pool->jobs[k]].platform_file);
+  }
+  unlink(output);
+  free(output);
+}
+
+/*
+ * Run the jobs of the platform of job 'first' with a pool of 'nworkers'
+ * workers. The parent prints the results of the jobs in order, as soon as
+ * they are available. A worker that fails is replaced by a new one, that
+ * takes over its deque, and the job it was running is reported as failed.
+ * Return the number of failed jobs.
+ */
+int run_platform_jobs_in_parallel(int njobs, BatchJob jobs, int first,
+    int nworkers, char *directory){
+  int i, k, w, status, nalive, failures = 0, next_to_print = 0;
+  pid_t pid;
+  struct _JobPool pool;
+
+  pool.directory = directory;
+  pool.jobs = (int*) shared_calloc(njobs, sizeof(int));
+  pool.njobs = 0;
+  for (i = first; i < njobs; i++)
+    if (!strcmp(jobs[i].platform_file, jobs[first].platform_file))
+      pool.jobs[pool.njobs++] = i;
+
+  pool.nworkers = MIN(nworkers, pool.njobs);
+  pool.head = (int*) shared_calloc(pool.nworkers, sizeof(int));
+  pool.tail = (int*) shared_calloc(pool.nworkers, sizeof(int));
+  pool.locks = (int*) shared_calloc(pool.nworkers, sizeof(int));
+  pool.running = (int*) shared_calloc(pool.nworkers, sizeof(int));
+  pool.states = (int*) shared_calloc(pool.njobs, sizeof(int));
+  pool.workers = (pid_t*) calloc (pool.nworkers, sizeof(pid_t));
+
+  /* Deal the jobs to the workers in contiguous blocks. */
+  for (w = 0; w < pool.nworkers; w++){
+    pool.head[w] = (w * pool.njobs) / pool.nworkers;
+    pool.tail[w] = ((w + 1) * pool.njobs) / pool.nworkers;
+    pool.running[w] = -1;
+  }
+
+  for (w = 0; w < pool.nworkers; w++)
+    pool_start_worker(&pool, jobs, w);
+  nalive = pool.nworkers;
+
+  while (next_to_print < pool.njobs){
+    __sync_synchronize();
+    if (pool.states[next_to_print] != JOB_PENDING){
+      pool_print_job(&pool, jobs, next_to_print++);
+      continue;
+    }
+
+    if (!nalive){
+      /* Nobody is left to run the remaining jobs */
+      for (k = next_to_print; k < pool.njobs; k++)
+        if (pool.states[k] == JOB_PENDING){
+          pool.states[k] = JOB_FAILED;
+          failures++;
+        }
+      continue;
+    }
+
+    pid = waitpid(-1, &status, WNOHANG);
+    if (pid <= 0){
+      usleep(1000);
+      continue;
+    }
+
+    for (w = 0; w < pool.nworkers && pool.workers[w] != pid; w++)
+      ;
+    if (w == pool.nworkers)
+      continue;
+    nalive--;
+    if (!WIFEXITED(status) || WEXITSTATUS(status)){
+      if (pool.running[w] >= 0){
+        XBT_WARN("Worker %d failed on '%s'", w,
+            jobs[pool.jobs[pool.running[w]]].dagfile);
+        pool.states[pool.running[w]] = JOB_FAILED;
+        pool.running[w] = -1;
+        failures++;
+      }
+      pool.locks[w] = 0;
+      pool_start_worker(&pool, jobs, w);
+      nalive++;
+    }
+  }
+
+  while (nalive-- > 0)
+    wait(&status);
+
+  free(pool.workers);
+  munmap(pool.jobs, njobs * sizeof(int));
+  munmap(pool.head, pool.nworkers * sizeof(int));
+  munmap(pool.tail, pool.nworkers * sizeof(int));
+  munmap(pool.locks, pool.nworkers * sizeof(int));
+  munmap(pool.running, pool.nworkers * sizeof(int));
+  munmap(pool.states, pool.njobs * sizeof(int));
+
+  return failures;
+}
+
+/*
+ * Run all the jobs of a batch manifest. As SimGrid can only load one platform
+ * per process, the jobs are grouped by platform, in the order of the first
+ * occurrence of each platform in the manifest, and each group is run by a
+ * forked process, or by a pool of 'batch_nworkers' workers. The results are
+ * printed in the usual format, in the same order in both cases.
+ */
+void run_batch(const char *manifest){
+  int i, j, njobs, status, failures = 0;
+  char directory[] = "/tmp/biCPA-XXXXXX";
+  pid_t pid;
+  BatchJob jobs;
+
+  njobs = read_batch_manifest(manifest, &jobs);
+  XBT_VERB("%d jobs read from '%s'", njobs, manifest);
+
+  if (batch_nworkers > 1)
+    xbt_assert(mkdtemp(directory), "Cannot create a temporary directory");
+
+  for (i = 0; i < njobs; i++){
+    if (jobs[i].done)
+      continue;
+
+    if (batch_nworkers > 1) {
+      failures += run_platform_jobs_in_parallel(njobs, jobs, i, batch_nworkers,
+          directory);
+      for (j = i; j < njobs; j++)
+        if (!strcmp(jobs[j].platform_file, jobs[i].platform_file))
+          jobs[j].done = 1;
+      continue;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    xbt_assert(pid >= 0, "Cannot fork the process for platform '%s'",
+        jobs[i].platform_file);
+    if (!pid){
+      run_platform_jobs(njobs, jobs, i);
+      fflush(stdout);
+      _exit(0);
+    }
+
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status)){
+      XBT_WARN("Jobs on platform '%s' failed", jobs[i].platform_file);
+      failures++;
+    }
+
+    for (j = i; j < njobs; j++)
+      if (!strcmp(jobs[j].platform_file, jobs[i].platform_file))
+        jobs[j].done = 1;
+  }
+
+  if (batch_nworkers > 1)
+    rmdir(directory);
+  xbt_assert(!failures, "%d failure(s) in batch mode", failures);
+  free_batch_jobs(njobs, jobs);
+}
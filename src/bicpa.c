@@ -7,11 +7,18 @@
  *****************************************************************************/
 #include <math.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include "simdag/simdag.h"
 #include "xbt.h"
 
 #include "bicpa.h"
 #include "dag.h"
+#include "graph.h"
+#include "path.h"
+#include "resultcache.h"
+#include "simulator.h"
 #include "task.h"
 #include "timer.h"
 #include "workstation.h"
@@ -33,30 +40,58 @@ Sched_info_t new_sched_info(int nworkstations, double makespan, double work,
   return s;
 }
 
+/*
+ * Copy the results of a schedule, for an assumed size of the target cluster
+ * that led to the same allocations.
+ */
+Sched_info_t copy_sched_info(int nworkstations, Sched_info_t s) {
+  Sched_info_t copy = (Sched_info_t) calloc (1, sizeof(struct _SchedInfo));
+  *copy = *s;
+  copy->nworkstations = nworkstations;
+  return copy;
+}
+
 /*
  * Run the simulation of a given 'dag' on a cluster that comprises
  * 'nworkstations' workstations, build and return the data structure with the
  * results of the schedule's simulation: makespan, work and peak resource usage.
+ * 'estimated_makespan' is the makespan estimated when the schedule was built.
+ * In estimate-only mode, it is used as the makespan and nothing is simulated.
+ * With the utilization profile, the work with communications is computed from
+ * the number of workstations busy at the same time, instead of the number of
+ * workstations used by the schedule.
  */
-Sched_info_t simulate_schedule(xbt_dynar_t dag, int nworkstations){
-  double makespan;
-  int peak_allocation;
-  xbt_dynar_t executed_tasks;
+Sched_info_t simulate_schedule(xbt_dynar_t dag, int nworkstations,
+    double estimated_makespan){
+  double makespan, busy_area = 0.0;
+  int peak_allocation, concurrent_peak = 0;
+  double utilization[UTILIZATION_BINS];
   Sched_info_t s;
 
-  makespan = SD_get_clock ();
-  executed_tasks = SD_simulate(-1.);
-  xbt_dynar_free_container(&executed_tasks);
-  makespan = SD_get_clock () - makespan;
+  if (simulator == ESTIMATE_ONLY)
+    makespan = estimated_makespan;
+  else
+    makespan = simulate_makespan(dag);
 
   peak_allocation = compute_peak_resource_usage();
+  if (utilization_profile)
+    concurrent_peak = compute_utilization_profile(UTILIZATION_BINS,
+        makespan, utilization, &busy_area);
+
   if (with_communications){
-    s = new_sched_info(nworkstations, makespan, makespan * peak_allocation,
+    s = new_sched_info(nworkstations, makespan, makespan *
+        (utilization_profile ? concurrent_peak : peak_allocation),
         peak_allocation);
   } else {
     s = new_sched_info(nworkstations, makespan, compute_total_work(dag),
         peak_allocation);
   }
+  s->estimated_makespan = estimated_makespan;
+  if (utilization_profile){
+    s->concurrent_peak = concurrent_peak;
+    s->idle_area = MAX(concurrent_peak * makespan - busy_area, 0.0);
+    memcpy(s->utilization, utilization, sizeof(utilization));
+  }
   return s;
 }
 
@@ -67,6 +102,9 @@ Sched_info_t simulate_schedule(xbt_dynar_t dag, int nworkstations){
 void print_sched_info(Sched_info_t s){
   XBT_VERB("[%d] makespan = %.3f, work = %.3f, peak_alloc = %d",
       s->nworkstations, s->makespan, s->work, s->peak_allocation);
+  if (utilization_profile)
+    XBT_VERB("[%d] concurrent peak = %d, idle area = %.3f", s->nworkstations,
+        s->concurrent_peak, s->idle_area);
 }
 
 /* Comparison function to sort schedule results by increasing makespan values */
@@ -143,17 +181,16 @@ int get_best_work_index(int nworkstations, Sched_info_t *list,
  *     considered as dominated.
  */
 void get_non_dominated_schedules(int *nno_dom, Sched_info_t **no_dom_list,
-    Sched_info_t *list){
+    int nschedules, Sched_info_t *list){
   int i;
-  const int nworkstations = SD_workstation_get_number();
 
-  qsort(list, nworkstations, sizeof(Sched_info_t), ImakespanCompareSchedInfo);
+  qsort(list, nschedules, sizeof(Sched_info_t), ImakespanCompareSchedInfo);
 
   (*no_dom_list) = (Sched_info_t*) calloc (1, sizeof(Sched_info_t));
   (*no_dom_list)[0] = list[0];
   (*nno_dom)++;
 
-  for (i = 1; i < nworkstations; i++){
+  for (i = 1; i < nschedules; i++){
     if (list[i]->work <= (*no_dom_list)[(*nno_dom)-1]->work){
       (*no_dom_list) = (Sched_info_t*) realloc ((*no_dom_list),
           ((*nno_dom)+1)*sizeof(Sched_info_t));
@@ -227,6 +264,241 @@ int get_best_tradeoff_nworkstations(int nschedules,
   return bicriteria_nworkstations;
 }
 
+/*
+ * Build and simulate the schedules for 'ncandidates' assumed sizes of the
+ * target cluster, given in 'candidates', and store the results in 'siList' in
+ * the same order.
+ */
+void evaluate_candidates_serial(xbt_dynar_t dag, int ncandidates,
+    int *candidates, Sched_info_t *siList){
+  int k;
+  double estimated_makespan;
+
+  for (k = 0; k < ncandidates; k++){
+    set_allocations_from_iteration(dag, candidates[k]);
+    estimated_makespan = map_allocations(dag);
+    siList[k] = simulate_schedule(dag, candidates[k], estimated_makespan);
+    print_sched_info(siList[k]);
+    reset_simulation (dag);
+  }
+}
+
+/*
+ * Parallel version of evaluate_candidates_serial(). As SimDag relies on a
+ * single simulation engine per process, the workers are forked processes. Each
+ * of them thus owns its own copy of the scheduling state of the tasks and
+ * workstations and of the simulation engine. The workers pull the indexes of
+ * the candidates to evaluate from a counter shared with the other workers, and
+ * write the results in a shared array at the index of the candidate. Once all
+ * the workers are done, the results are copied in 'siList', that is then the
+ * same as with a serial evaluation.
+ */
+void evaluate_candidates_parallel(xbt_dynar_t dag, int ncandidates,
+    int *candidates, Sched_info_t *siList, int nworkers){
+  int k, w, status, failures = 0;
+  int *next_candidate;
+  pid_t *workers;
+  Sched_info_t s;
+  struct _SchedInfo *results;
+
+  results = (struct _SchedInfo*) mmap(NULL,
+      ncandidates * sizeof(struct _SchedInfo), PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  next_candidate = (int*) mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  xbt_assert(results != MAP_FAILED && next_candidate != MAP_FAILED,
+      "Cannot allocate memory shared with the workers");
+  *next_candidate = 0;
+
+  workers = (pid_t*) calloc (nworkers, sizeof(pid_t));
+  fflush(stdout);
+  fflush(stderr);
+
+  for (w = 0; w < nworkers; w++){
+    workers[w] = fork();
+    xbt_assert(workers[w] >= 0, "Cannot fork worker %d", w);
+    if (!workers[w]) {
+      while ((k = __sync_fetch_and_add(next_candidate, 1)) < ncandidates){
+        set_allocations_from_iteration(dag, candidates[k]);
+        s = simulate_schedule(dag, candidates[k], map_allocations(dag));
+        results[k] = *s;
+        free(s);
+        reset_simulation (dag);
+      }
+      fflush(stdout);
+      _exit(0);
+    }
+  }
+
+  for (w = 0; w < nworkers; w++){
+    waitpid(workers[w], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status))
+      failures++;
+  }
+  xbt_assert(!failures, "%d worker(s) failed to evaluate candidates", failures);
+
+  for (k = 0; k < ncandidates; k++){
+    siList[k] = copy_sched_info(results[k].nworkstations, &(results[k]));
+    print_sched_info(siList[k]);
+  }
+
+  free(workers);
+  munmap(next_candidate, sizeof(int));
+  munmap(results, ncandidates * sizeof(struct _SchedInfo));
+}
+
+/*
+ * Hash the allocations determined for the compute tasks for the assumed size
+ * 'index' of the target cluster (FNV-1a hash function).
+ */
+unsigned long hash_iterative_allocations(int index){
+  int i;
+  unsigned long hash = 14695981039346656037UL;
+
+  for (i = 0; i < graph->ncompute; i++)
+    if (SD_task_get_kind(graph->tasks[i]) == SD_TASK_COMP_PAR_AMDAHL){
+      hash ^= (unsigned long)
+          SD_task_get_iterative_allocations(graph->tasks[i], index);
+      hash *= 1099511628211UL;
+    }
+  return hash;
+}
+
+/*
+ * Check whether all the compute tasks have the same allocation for the assumed
+ * sizes 'index1' and 'index2' of the target cluster.
+ */
+int same_iterative_allocations(int index1, int index2){
+  int i;
+
+  for (i = 0; i < graph->ncompute; i++)
+    if (SD_task_get_kind(graph->tasks[i]) == SD_TASK_COMP_PAR_AMDAHL &&
+        SD_task_get_iterative_allocations(graph->tasks[i], index1) !=
+        SD_task_get_iterative_allocations(graph->tasks[i], index2))
+      return 0;
+  return 1;
+}
+
+/*
+ * Different assumed sizes of the target cluster often lead to exactly the same
+ * allocation for every task, hence to the same schedule. This function
+ * collapses the 'nsizes' sizes given in 'sizes' into distinct allocations. The
+ * first size that leads to each distinct allocation is stored in 'candidates'
+ * and, for each size, the index of the candidate that has the same allocation
+ * is stored in 'candidate_index'. Allocations are hashed in an open addressing
+ * table and compared entirely when hashes are equal. The number of candidates
+ * is returned.
+ */
+int get_distinct_allocations(int nsizes, int *sizes, int *candidates,
+    int *candidate_index){
+  int i, ncandidates = 0;
+  unsigned int k, table_size = 1;
+  int *table;
+  unsigned long *hashes, hash;
+
+  while (table_size < 2 * (unsigned int) nsizes)
+    table_size *= 2;
+  table = (int*) calloc (table_size, sizeof(int));
+  hashes = (unsigned long*) calloc (nsizes, sizeof(unsigned long));
+  for (k = 0; k < table_size; k++)
+    table[k] = -1;
+
+  for (i = 0; i < nsizes; i++){
+    hash = hash_iterative_allocations(sizes[i]);
+    k = hash & (table_size - 1);
+    while (table[k] >= 0 && (hashes[table[k]] != hash ||
+        !same_iterative_allocations(candidates[table[k]], sizes[i])))
+      k = (k + 1) & (table_size - 1);
+
+    if (table[k] < 0){
+      hashes[ncandidates] = hash;
+      candidates[ncandidates] = sizes[i];
+      table[k] = ncandidates++;
+    } else {
+      XBT_DEBUG("[%d] same allocations as with %d workstations", sizes[i],
+          candidates[table[k]]);
+    }
+    candidate_index[i] = table[k];
+  }
+
+  free(table);
+  free(hashes);
+  return ncandidates;
+}
+
+/*
+ * Compare the makespans estimated while building 'n' schedules to their
+ * simulated values, and report the relative errors of the estimates: mean
+ * (signed) error, mean and maximum absolute errors, and the number of estimates
+ * within 1% and 5% of the simulated makespan.
+ */
+void report_estimation_errors(int n, Sched_info_t *list){
+  int i, within_1 = 0, within_5 = 0;
+  double error, sum = 0.0, sum_abs = 0.0, max_abs = 0.0;
+
+  for (i = 0; i < n; i++){
+    error = (list[i]->makespan > 0) ?
+        (list[i]->estimated_makespan - list[i]->makespan) / list[i]->makespan :
+        0.0;
+    XBT_DEBUG("[%d] estimated makespan = %.3f, simulated = %.3f (%+.2f%%)",
+        list[i]->nworkstations, list[i]->estimated_makespan,
+        list[i]->makespan, 100 * error);
+    sum += error;
+    sum_abs += fabs(error);
+    max_abs = MAX(max_abs, fabs(error));
+    if (fabs(error) <= 0.01)
+      within_1++;
+    if (fabs(error) <= 0.05)
+      within_5++;
+  }
+
+  XBT_VERB("Estimated vs. simulated makespans of %d schedules: mean error "
+      "%+.2f%%, mean absolute error %.2f%%, max %.2f%%, %d within 1%%, %d "
+      "within 5%%", n, 100 * sum / MAX(n, 1), 100 * sum_abs / MAX(n, 1),
+      100 * max_abs, within_1, within_5);
+}
+
+/*
+ * Build and simulate the schedules for the 'nsizes' assumed sizes of the target
+ * cluster given in 'sizes', and store the results in 'siList' in the same
+ * order. Each distinct allocation is evaluated only once, either serially or
+ * by several workers, and its results are copied for all the sizes that lead
+ * to it.
+ */
+void evaluate_candidates(xbt_dynar_t dag, int nsizes, int *sizes,
+    Sched_info_t *siList){
+  int i, ncandidates;
+  int *candidates, *candidate_index;
+  Sched_info_t *results;
+
+  candidates = (int*) calloc (nsizes, sizeof(int));
+  candidate_index = (int*) calloc (nsizes, sizeof(int));
+  ncandidates = get_distinct_allocations(nsizes, sizes, candidates,
+      candidate_index);
+  XBT_VERB("%d distinct allocations out of %d: %d simulations saved",
+      ncandidates, nsizes, nsizes - ncandidates);
+
+  results = (Sched_info_t*) calloc (nsizes, sizeof(Sched_info_t));
+  if (nthreads > 1 && ncandidates > 1)
+    evaluate_candidates_parallel(dag, ncandidates, candidates, results,
+        MIN(nthreads, ncandidates));
+  else
+    evaluate_candidates_serial(dag, ncandidates, candidates, results);
+
+  if (simulator != ESTIMATE_ONLY)
+    report_estimation_errors(ncandidates, results);
+
+  for (i = 0; i < nsizes; i++){
+    siList[i] = copy_sched_info(sizes[i], results[candidate_index[i]]);
+  }
+
+  for (i = 0; i < ncandidates; i++)
+    free(results[i]);
+  free(results);
+  free(candidates);
+  free(candidate_index);
+}
+
 /*
  * Initialize the average area (sum of the execution time of all compute task,
  * divided by the size of the cluster) assuming that the cluster comprises only
@@ -234,13 +506,17 @@ int get_best_tradeoff_nworkstations(int nschedules,
  * execution times on a single workstation.
  */
 double initialize_average_area(xbt_dynar_t dag) {
-  unsigned int i;
+  int i;
   double ta = 0.0;
-  SD_task_t task;
 
-  xbt_dynar_foreach(dag, i, task)
-    if(SD_task_get_kind(task) == SD_TASK_COMP_PAR_AMDAHL)
-      ta += SD_task_estimate_execution_time(task, 1);
+  for (i = 0; i < graph->ncompute; i++)
+    graph->scratch[i] = 1;
+
+  SD_task_estimate_execution_times(graph->ncompute, NULL, graph->scratch,
+      graph->estimates);
+
+  for (i = 0; i < graph->ncompute; i++)
+    ta += graph->estimates[i];
 
   return ta;
 }
@@ -266,31 +542,45 @@ double initialize_average_area(xbt_dynar_t dag) {
  * number of workstations in the cluster is incremented. The final iteration of
  * this outer loop corresponds to the original allocation procedure of the CPA
  * algorithm.
+ * The allocations are only stored for the 'nsizes' assumed sizes given in
+ * 'sizes', in increasing order, and the outer loop stops at the largest of
+ * them. As the procedure starts from scratch, it can be called again for other
+ * sizes, the allocations stored for a size being the same whatever the call.
  */
-void set_multiple_allocations(xbt_dynar_t dag) {
-  unsigned int i;
-  int n, saturation = 0;
-  double maximum_gain, current_gain, TCP, TA;
-  int current_nworkstations = 1;
+void set_multiple_allocations(xbt_dynar_t dag, int nsizes, const int *sizes) {
+  int task, saturation = 0;
+  double TCP, TA;
+  int current_nworkstations = 1, next_size = 0;
   int iteration = 0;
   const int nworkstations = SD_workstation_get_number();
-  xbt_dynar_t children, grand_children;
-  SD_task_t task, child, current_child, selected_task, max_BL_child=NULL;
+  CriticalPath path;
+  SD_task_t selected_task;
 
   /*
    * Initialize TA and TCP assuming the cluster comprises only one workstation.
    * Then each task is allocated on a single workstation.
    */
+  graph_restore_initial_state(graph);
   TA = initialize_average_area(dag);
   TCP = SD_task_get_bottom_level(get_dag_root(dag));
   XBT_VERB("Initial values for TA and TCP are (%.3f, %.3f)", TA, TCP);
 
+  /*
+   * Build the current critical path of the DAG, by finding the tasks with the
+   * biggest level among compute successors of the current task in top-down
+   * fashion. The gain in terms of reduction of the execution time if it is
+   * allocated on one more workstation is estimated for each task of this path.
+   * Both are then maintained as bottom levels change.
+   */
+  path = critical_path_new(nworkstations);
+
   /*
    * Loop to dynamically change the assumed size of the target cluster from 1
-   * to the total number of workstations ('nworkstations'). This impacts the
-   * computation of the average area TA.
+   * to the largest requested size (the total number of workstations,
+   * 'nworkstations', unless sampling). This impacts the computation of the
+   * average area TA.
    */
-  while (current_nworkstations <= nworkstations) {
+  while (current_nworkstations <= sizes[nsizes-1]) {
     XBT_DEBUG("Assume the cluster comprises %d workstations",
         current_nworkstations);
     XBT_DEBUG("  Current values for TA and TCP are (%.3f, %.3f)", TA, TCP);
@@ -310,68 +600,14 @@ void set_multiple_allocations(xbt_dynar_t dag) {
           (TA*current_nworkstations)/nworkstations,
           TA, TCP);
 
-      selected_task = NULL;
-      maximum_gain = -1.0;
-      task = get_dag_root(dag);
-
       /*
-       * Browse the current critical path of the DAG in top-down fashion, by
-       * finding the tasks with the biggest level among compute successors of
-       * the current task.
+       * The task of the critical path with the best gain is selected for
+       * allocation increase. In case of ties, the first one on the path is
+       * selected.
        */
-      while ((strcmp(SD_task_get_name(task), "end"))) {
-        children = SD_task_get_children(task);
-        xbt_dynar_foreach(children, i, child){
-          if (SD_task_get_kind(child) == SD_TASK_COMM_PAR_MXN_1D_BLOCK) {
-            grand_children = SD_task_get_children(child);
-            xbt_dynar_get_cpy(grand_children, 0, &current_child);
-            xbt_dynar_free_container(&grand_children);
-          } else {
-            current_child = child;
-          }
-          if (!i ||
-              (SD_task_get_bottom_level(max_BL_child) <
-                  SD_task_get_bottom_level(current_child))){
-            max_BL_child = current_child;
-          }
-        }
-        xbt_dynar_free_container(&children);
-
-        XBT_DEBUG("Next candidate task on the critical path is task '%s'",
-            SD_task_get_name(max_BL_child));
-
-        n = SD_task_get_allocation_size(max_BL_child);
-        XBT_DEBUG("Current allocation for task '%s' is %d workstations",
-            SD_task_get_name(max_BL_child), n);
-
-        /*
-         * Estimate what would be the 'current_gain' in terms of reduction of
-         * the execution time if the task is allocated on one more workstation.
-         * If the task is already allocated on the full cluster, this
-         * 'current_gain' is zero.
-         */
-        if (n < nworkstations){
-          current_gain = SD_task_estimate_execution_time(max_BL_child, n) / n -
-              SD_task_estimate_execution_time(max_BL_child, (n+1)) / (n+1);
-        } else {
-          current_gain = 0.0;
-        }
+      task = critical_path_get_best_task(path);
 
-        /*
-         * If the current task lead to a better gain that the one currently
-         * stored, consider it as the new candidate for allocation increase and
-         * store the new 'maximum_gain' value.
-         */
-        if (current_gain > 0.0 && maximum_gain < current_gain) {
-          maximum_gain = current_gain;
-          selected_task = max_BL_child;
-        }
-
-        /* Continue to browse the critical path */
-        task = max_BL_child;
-      }
-
-      if (!selected_task) {
+      if (task < 0) {
         /*
          * The cluster is saturated. No task can be selected anymore for
          * allocation increase. Stop the allocation procedure
@@ -383,6 +619,9 @@ void set_multiple_allocations(xbt_dynar_t dag) {
          * benefits the most of an extra workstation. Increment its allocation
          * size.
          */
+        selected_task = graph->tasks[task];
+        XBT_DEBUG("Task '%s' is selected (gain = %f)",
+            SD_task_get_name(selected_task), path->gains[task]);
         SD_task_set_allocation_size(selected_task,
             SD_task_get_allocation_size(selected_task)+1);
         /*
@@ -396,24 +635,30 @@ void set_multiple_allocations(xbt_dynar_t dag) {
                   current_nworkstations);
 
         /*
-         * Recompute TCP, by resetting the bottom levels with the new
-         * allocations and using the bottom level value of 'root'.
+         * Recompute TCP, by updating the bottom levels of the selected task and
+         * of its ancestors with the new allocation and using the bottom level
+         * value of 'root'. Then update the critical path where these bottom
+         * levels changed.
          */
-        set_bottom_levels(dag);
+        update_bottom_levels(selected_task);
         TCP = SD_task_get_bottom_level(get_dag_root(dag));
+        critical_path_update(path, task);
       }
       iteration++;
     }
 
     /*
      * A tradeoff has been found between TCP and TA. Store the current
-     * allocations for the tasks.
+     * allocations for the tasks, if this size is requested.
      */
-    xbt_dynar_foreach(dag, i, task){
-      if (SD_task_get_kind(task) == SD_TASK_COMP_PAR_AMDAHL){
-        SD_task_set_iterative_allocations(task, current_nworkstations,
-            SD_task_get_allocation_size(task));
+    if (current_nworkstations == sizes[next_size]){
+      for (task = 0; task < graph->ncompute; task++){
+        if (SD_task_get_kind(graph->tasks[task]) == SD_TASK_COMP_PAR_AMDAHL){
+          SD_task_set_iterative_allocations(graph->tasks[task],
+              current_nworkstations, graph->attributes[task].allocation_size);
+        }
       }
+      next_size++;
     }
 
     /*
@@ -425,30 +670,387 @@ void set_multiple_allocations(xbt_dynar_t dag) {
     /* Increase the assumed size of the target cluster. */
     current_nworkstations++;
   }
+
+  critical_path_free(path);
 }
 
 
-void schedule_with_biCPA(xbt_dynar_t dag) {
+/*
+ * Candidate screening. The schedules of all the assumed sizes of the target
+ * cluster are first built without simulation, and ranked by their estimated
+ * makespans and analytic works. Only the sizes whose estimates are within a
+ * relative 'distance' of the front of the non-dominated estimates are then
+ * simulated, i.e., the sizes whose estimated makespan and work both are at
+ * most (1 + distance) times those of a non-dominated estimate. The CPA
+ * reference, on all the workstations, is always simulated.
+ * The non-dominated estimates, sorted by increasing makespans, have decreasing
+ * works. For a given size, the front points whose makespan is large enough
+ * form a suffix of the front, and the first of them has the largest work. It is
+ * found by binary search. The selected sizes are stored in 'selected' in
+ * increasing order, and their number is returned.
+ */
+int screen_candidates(int nsizes, Sched_info_t *estimates, double distance,
+    int *selected){
+  int i, nfront = 0, nselected = 0, low, high, middle;
+  Sched_info_t *sorted, *front;
+
+  sorted = (Sched_info_t*) calloc (nsizes, sizeof(Sched_info_t));
+  front = (Sched_info_t*) calloc (nsizes, sizeof(Sched_info_t));
+  memcpy(sorted, estimates, nsizes * sizeof(Sched_info_t));
+  qsort(sorted, nsizes, sizeof(Sched_info_t), ImakespanCompareSchedInfo);
+  for (i = 0; i < nsizes; i++)
+    if (!nfront || sorted[i]->work < front[nfront-1]->work)
+      front[nfront++] = sorted[i];
+
+  for (i = 0; i < nsizes; i++){
+    low = 0;
+    high = nfront;
+    while (low < high){
+      middle = (low + high) / 2;
+      if (front[middle]->makespan * (1 + distance) < estimates[i]->makespan)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    if (estimates[i]->nworkstations == nsizes || (low < nfront &&
+        estimates[i]->work <= front[low]->work * (1 + distance)))
+      selected[nselected++] = estimates[i]->nworkstations;
+  }
+
+  XBT_VERB("Screening: %d non-dominated estimates, %d sizes out of %d to "
+      "simulate", nfront, nselected, nsizes);
+  free(sorted);
+  free(front);
+  return nselected;
+}
+
+/*
+ * Build and evaluate the schedules for all the assumed sizes of the target
+ * cluster, from 1 to 'nworkstations', and store the results in 'siList'.
+ * With screening, the schedules of all the sizes are only estimated first, and
+ * those of the selected sizes are then simulated. Return the number of results.
+ */
+int evaluate_schedules(xbt_dynar_t dag, int nworkstations, Sched_info_t *siList,
+    int screening){
+  int j, nselected, selected_simulator = simulator;
+  int *sizes, *selected;
+
+  sizes = (int*) calloc (nworkstations, sizeof(int));
+  for (j = 1; j <= nworkstations; j++)
+    sizes[j-1] = j;
+
+  if (!screening || simulator == ESTIMATE_ONLY){
+    evaluate_candidates(dag, nworkstations, sizes, siList);
+    free(sizes);
+    return nworkstations;
+  }
+
+  simulator = ESTIMATE_ONLY;
+  evaluate_candidates(dag, nworkstations, sizes, siList);
+  simulator = selected_simulator;
+
+  selected = (int*) calloc (nworkstations, sizeof(int));
+  nselected = screen_candidates(nworkstations, siList, screening_distance,
+      selected);
+  for (j = 0; j < nworkstations; j++)
+    free(siList[j]);
+
+  evaluate_candidates(dag, nselected, selected, siList);
+
+  free(sizes);
+  free(selected);
+  return nselected;
+}
+
+/*
+ * Determine the assumed sizes of the target cluster (hence the tasks'
+ * allocations) that lead to the four biCPA variants, from the evaluated
+ * schedules of a result:
+ * biCPA-M: smallest makespan without degrading the work achieved by CPA.
+ * biCPA-W: smallest work without degrading the makespan achieved by CPA.
+ * biCPA-E: bi-criteria optimization that favors the perfect equity of the
+ *          gains w.r.t. CPA in terms of makespan and work.
+ * biCPA-S: bi-criteria optimization that minimizes the sum of the gains
+ *          w.r.t. CPA in terms of makespan and work.
+ * The schedule on the whole cluster corresponds to the one built from the
+ * seminal CPA allocation procedure. The achieved makespan and work are used to
+ * determine the bi-criteria optimizations.
+ */
+void select_biCPA_variants(BiCPA_result_t r){
+  int i, nno_dom = 0;
+  double cpa_makespan = 0.0, cpa_work = 0.0;
+  Sched_info_t *siList = r->siList, *no_dom_list = NULL;
+
+  for (i = 0; i < r->nschedules; i++)
+    if (siList[i]->nworkstations == r->nworkstations){
+      cpa_makespan = siList[i]->makespan;
+      cpa_work = siList[i]->work;
+    }
+
+  for (i = 0; i < r->nschedules; i++){
+    XBT_VERB("%d: %.3f (%.3f) %.3f (%.3f)", siList[i]->nworkstations,
+        siList[i]->makespan, siList[i]->makespan/cpa_makespan,
+        siList[i]->work, siList[i]->work/cpa_work);
+  }
+
+  r->best_work_nworkstations =
+      siList[get_best_work_index(r->nschedules,
+          siList, cpa_makespan)]->nworkstations;
+
+  r->best_makespan_nworkstations =
+      siList[get_best_makespan_index(r->nschedules,
+          siList, cpa_work)]->nworkstations;
+
+  get_non_dominated_schedules(&nno_dom, &no_dom_list, r->nschedules, siList);
+  r->perfect_equity_nworkstations =
+      get_best_tradeoff_nworkstations(nno_dom, no_dom_list,
+          cpa_makespan, cpa_work, 1);
+
+  r->min_sum_nworkstations =
+      get_best_tradeoff_nworkstations(nno_dom, no_dom_list,
+          cpa_makespan, cpa_work, 0);
+
+  XBT_VERB("The four variants of biCPA assumes the following cluster sizes:");
+  XBT_VERB("  * biCPA-M: %d", r->best_makespan_nworkstations);
+  XBT_VERB("  * biCPA-W: %d", r->best_work_nworkstations);
+  XBT_VERB("  * biCPA-E: %d", r->perfect_equity_nworkstations);
+  XBT_VERB("  * biCPA-S: %d", r->min_sum_nworkstations);
+
+  free(no_dom_list);
+}
+
+/* Return the result of a schedule in 'r' for a given size (NULL if none) */
+static Sched_info_t get_sched_info(BiCPA_result_t r, int nworkstations){
+  int i;
+
+  for (i = 0; i < r->nschedules; i++)
+    if (r->siList[i]->nworkstations == nworkstations)
+      return r->siList[i];
+  return NULL;
+}
+
+/*
+ * Check a variant selected with screening against the exhaustive evaluation.
+ * Both selections agree if they lead to the same makespan and work, even with
+ * different sizes. As successive simulations start at different dates, the
+ * makespans of a same schedule may differ by rounding errors, hence the
+ * relative tolerance. Return 0 if they do not agree.
+ */
+static int check_screened_variant(const char *variant, BiCPA_result_t screened,
+    int screened_size, BiCPA_result_t exhaustive, int exhaustive_size){
+  Sched_info_t s = get_sched_info(screened, screened_size);
+  Sched_info_t e = get_sched_info(exhaustive, exhaustive_size);
+
+  if (fabs(s->makespan - e->makespan) <= 1e-9 * e->makespan &&
+      fabs(s->work - e->work) <= 1e-9 * e->work)
+    return 1;
+  XBT_WARN("Screening changed %s: %d workstations (%.3f, %.3f) instead of %d "
+      "(%.3f, %.3f)", variant, screened_size, s->makespan, s->work,
+      exhaustive_size, e->makespan, e->work);
+  return 0;
+}
+
+/*
+ * Verification of the screening: evaluate the schedules of all the assumed
+ * sizes, select the four variants from them, and compare to those selected
+ * with screening.
+ */
+void verify_screening(xbt_dynar_t dag, BiCPA_result_t screened){
+  int nagreements;
+  BiCPA_result_t exhaustive;
+
+  exhaustive = (BiCPA_result_t) calloc (1, sizeof(struct _BiCPAResult));
+  exhaustive->nworkstations = screened->nworkstations;
+  exhaustive->siList = (Sched_info_t*) calloc (exhaustive->nworkstations,
+      sizeof(Sched_info_t));
+  exhaustive->nschedules = evaluate_schedules(dag, exhaustive->nworkstations,
+      exhaustive->siList, 0);
+  select_biCPA_variants(exhaustive);
+
+  nagreements =
+      check_screened_variant("biCPA-M", screened,
+          screened->best_makespan_nworkstations, exhaustive,
+          exhaustive->best_makespan_nworkstations) +
+      check_screened_variant("biCPA-W", screened,
+          screened->best_work_nworkstations, exhaustive,
+          exhaustive->best_work_nworkstations) +
+      check_screened_variant("biCPA-E", screened,
+          screened->perfect_equity_nworkstations, exhaustive,
+          exhaustive->perfect_equity_nworkstations) +
+      check_screened_variant("biCPA-S", screened,
+          screened->min_sum_nworkstations, exhaustive,
+          exhaustive->min_sum_nworkstations);
+  XBT_VERB("Screening verified: %d of 4 variants as with all the sizes, %d "
+      "schedules simulated instead of %d", nagreements, screened->nschedules,
+      exhaustive->nschedules);
+
+  free_biCPA_result(exhaustive);
+}
+
+/*
+ * Should the interval of assumed sizes between the evaluated sizes 'a' and 'b'
+ * be refined? As the allocations only grow with the assumed size, all the sizes
+ * in between have the same allocations, hence the same schedule, if 'a' and 'b'
+ * have. Otherwise, the interval is refined if the makespan or the work changes
+ * by at least 'threshold' (relative to the smallest value), or if only one of
+ * its bounds is non-dominated (Pareto transition). A null threshold thus leads
+ * to the same results as the evaluation of all the sizes.
+ */
+static int must_refine(Sched_info_t a, Sched_info_t b, int a_front,
+    int b_front, double threshold){
+  if (b->nworkstations - a->nworkstations < 2 ||
+      same_iterative_allocations(a->nworkstations, b->nworkstations))
+    return 0;
+  return a_front != b_front ||
+      fabs(a->makespan - b->makespan) >=
+        threshold * MIN(a->makespan, b->makespan) ||
+      fabs(a->work - b->work) >= threshold * MIN(a->work, b->work);
+}
+
+/*
+ * Coarse-to-fine sampling of the assumed sizes of the target cluster. A
+ * geometric set of sizes (1, 2, 4, ..., and 'nworkstations') is evaluated
+ * first. Then, in each round, the intervals between consecutive evaluated sizes
+ * that must be refined are split in their middle, and the middle sizes are
+ * evaluated, until no interval has to be refined. Only the evaluations are
+ * sampled: the allocations of all the sizes are determined beforehand, in the
+ * single sweep of set_multiple_allocations() up to 'nworkstations', which only
+ * keeps the sizes where the allocation of a task changes. A middle size whose
+ * allocations are the same as those of a bound of its interval gets the results
+ * of this bound without evaluation. The results are stored in 'siList', and
+ * their number is returned. The time spent to determine the allocations is
+ * added to 'alloc_time'.
+ */
+int sample_schedules(xbt_dynar_t dag, int nworkstations, Sched_info_t *siList,
+    double threshold, double *alloc_time){
+  int i, n, nschedules = 0, nsizes = 0, nnew, nround = 0, nno_dom;
+  int *sizes, *new_sizes, *bounds, *front;
+  double start;
+  Sched_info_t *by_size, *sorted, *no_dom_list = NULL, s;
+
+  /* Evaluated results indexed by size, and non-dominated sizes */
+  by_size = (Sched_info_t*) calloc (nworkstations + 1, sizeof(Sched_info_t));
+  front = (int*) calloc (nworkstations + 1, sizeof(int));
+  sorted = (Sched_info_t*) calloc (nworkstations, sizeof(Sched_info_t));
+  sizes = (int*) calloc (nworkstations, sizeof(int));
+  new_sizes = (int*) calloc (nworkstations, sizeof(int));
+  bounds = (int*) calloc (2 * nworkstations, sizeof(int));
+
+  for (n = 1; n <= nworkstations; n++)
+    sizes[n-1] = n;
+  start = get_time();
+  set_multiple_allocations(dag, nworkstations, sizes);
+  *alloc_time += get_time() - start;
+
+  for (n = 1; n < nworkstations; n *= 2)
+    new_sizes[nsizes++] = n;
+  new_sizes[nsizes++] = nworkstations;
+  nnew = nsizes;
+
+  while (nnew){
+    nround++;
+
+    /* Reuse the results of a bound with the same allocations */
+    for (i = 0, n = 0; i < nnew; i++){
+      s = NULL;
+      if (nround > 1 && same_iterative_allocations(new_sizes[i],
+          bounds[2*i]))
+        s = by_size[bounds[2*i]];
+      else if (nround > 1 && same_iterative_allocations(new_sizes[i],
+          bounds[2*i+1]))
+        s = by_size[bounds[2*i+1]];
+      if (s){
+        siList[nschedules] = copy_sched_info(new_sizes[i], s);
+        by_size[new_sizes[i]] = siList[nschedules++];
+      } else {
+        new_sizes[n++] = new_sizes[i];
+      }
+    }
+    evaluate_candidates(dag, n, new_sizes, siList + nschedules);
+    for (i = 0; i < n; i++)
+      by_size[new_sizes[i]] = siList[nschedules + i];
+    nschedules += n;
+
+    /* Evaluated sizes in increasing order, and non-dominated ones */
+    for (nsizes = 0, n = 1; n <= nworkstations; n++)
+      if (by_size[n]){
+        sizes[nsizes++] = n;
+        front[n] = 0;
+      }
+    memcpy(sorted, siList, nschedules * sizeof(Sched_info_t));
+    nno_dom = 0;
+    get_non_dominated_schedules(&nno_dom, &no_dom_list, nschedules, sorted);
+    for (i = 0; i < nno_dom; i++)
+      front[no_dom_list[i]->nworkstations] = 1;
+    free(no_dom_list);
+    no_dom_list = NULL;
+
+    /*
+     * Intervals to refine. The bounds of the interval of the i-th new size are
+     * kept in bounds[2*i] and bounds[2*i+1] for the reuse of results.
+     */
+    for (i = 0, nnew = 0; i < nsizes - 1; i++)
+      if (must_refine(by_size[sizes[i]], by_size[sizes[i+1]], front[sizes[i]],
+          front[sizes[i+1]], threshold)){
+        new_sizes[nnew] = (sizes[i] + sizes[i+1]) / 2;
+        bounds[2*nnew] = sizes[i];
+        bounds[2*nnew+1] = sizes[i+1];
+        nnew++;
+      }
+  }
+
+  XBT_VERB("Sampling: %d sizes out of %d evaluated in %d rounds", nschedules,
+      nworkstations, nround);
+  free(by_size);
+  free(front);
+  free(sorted);
+  free(sizes);
+  free(new_sizes);
+  free(bounds);
+  return nschedules;
+}
+
+/*
+ * Run biCPA on 'dag', and return its results: the schedule results for the
+ * evaluated assumed sizes of the target cluster, in the order they are
+ * displayed, and the sizes selected by the four variants of biCPA.
+ */
+BiCPA_result_t compute_biCPA(xbt_dynar_t dag) {
   unsigned int i, j;
-  int best_makespan_nworkstations, best_work_nworkstations;
-  int perfect_equity_nworkstations, min_sum_nworkstations;
   const int nworkstations = SD_workstation_get_number();
-  double cpa_makespan, cpa_work;
-  double alloc_time, mapping_time;
+  int n, *sizes;
   SD_task_t task;
-  int nno_dom=0;
-  Sched_info_t *siList, *no_dom_list=NULL;
+  BiCPA_result_t r;
 
-  siList = (Sched_info_t*) calloc (nworkstations, sizeof(Sched_info_t));
+  r = (BiCPA_result_t) calloc (1, sizeof(struct _BiCPAResult));
+  r->nworkstations = nworkstations;
+  r->siList = (Sched_info_t*) calloc (nworkstations, sizeof(Sched_info_t));
+
+  /*
+   * With sampling, the allocations are determined and the schedules evaluated
+   * round by round, for the sampled sizes only.
+   */
+  if (sampling_threshold >= 0.){
+    r->mapping_time = get_time();
+    r->nschedules = sample_schedules(dag, nworkstations, r->siList,
+        sampling_threshold, &(r->alloc_time));
+    select_biCPA_variants(r);
+    r->mapping_time = get_time() - r->mapping_time - r->alloc_time;
+    return r;
+  }
 
   /*
    * First step: Determine multiple allocations for each task, one for each
    * assumed size of the target cluster between 1 and nworkstations.
    */
-  alloc_time = get_time();
-  set_multiple_allocations (dag);
-  alloc_time = get_time() - alloc_time;
-  XBT_VERB("Allocations built in %f seconds", alloc_time);
+  sizes = (int*) calloc (nworkstations, sizeof(int));
+  for (n = 1; n <= nworkstations; n++)
+    sizes[n-1] = n;
+  r->alloc_time = get_time();
+  set_multiple_allocations (dag, nworkstations, sizes);
+  r->alloc_time = get_time() - r->alloc_time;
+  free(sizes);
+  XBT_VERB("Allocations built in %f seconds", r->alloc_time);
 
   /* Display all allocations in DEBUG mode */
   if (XBT_LOG_ISENABLED(heuristic, xbt_log_priority_debug))
@@ -462,110 +1064,121 @@ void schedule_with_biCPA(xbt_dynar_t dag) {
 
   /*
    * Second step: Build and simulate a schedule for each assumed size of the
-   * target cluster. Store the performance metrics (makespan, work, peak
-   * resource usage) for each of them.
+   * target cluster, or for the promising ones with screening. Store the
+   * performance metrics (makespan, work, peak resource usage) for each of them.
    */
-  mapping_time = get_time();
+  r->mapping_time = get_time();
+  r->nschedules = evaluate_schedules(dag, nworkstations, r->siList,
+      screening_distance >= 0.);
 
-  for (j = 1; j <= nworkstations; j++){
-    set_allocations_from_iteration(dag, j);
-    map_allocations(dag);
-    siList[j-1] = simulate_schedule(dag, j);
-    print_sched_info(siList[j-1]);
-    reset_simulation (dag);
-  }
+  /* Third step: determine the sizes that lead to the four biCPA variants */
+  select_biCPA_variants(r);
+  r->mapping_time = get_time() - r->mapping_time;
 
-  /*
-   * The last schedule (on the whole cluster that comprises 'nworkstations'
-   * corresponds to the one built from the seminal CPA allocation procedure.
-   * The achieved makespan and work will be used to determine the bi-criteria
-   * optimizations.
-   */
-  cpa_makespan = siList[nworkstations-1]->makespan;
-  cpa_work = siList[nworkstations-1]->work;
+  if (screening_distance >= 0. && verify_screening_results &&
+      simulator != ESTIMATE_ONLY)
+    verify_screening(dag, r);
 
-  /*
-   * Third step: determine the assumed sizes of the target cluster (hence the
-   * tasks' allocations) that lead to the four biCPA variants:
-   * biCPA-M: smallest makespan without degrading the work achieved by CPA.
-   * biCPA-W: smallest work without degrading the makespan achieved by CPA.
-   * biCPA-E: bi-criteria optimization that favors the perfect equity of the
-   *          gains w.r.t. CPA in terms of makespan and work.
-   * biCPA-S: bi-criteria optimization that minimizes the sum of the gains
-   *          w.r.t. CPA in terms of makespan and work.
-   */
-  for (i = 0; i < nworkstations; i++){
-    XBT_VERB("%d: %.3f (%.3f) %.3f (%.3f)", siList[i]->nworkstations,
-        siList[i]->makespan, siList[i]->makespan/cpa_makespan,
-        siList[i]->work, siList[i]->work/cpa_work);
-  }
+  return r;
+}
 
-  best_work_nworkstations =
-      siList[get_best_work_index(nworkstations,
-          siList, cpa_makespan)]->nworkstations;
+/*
+ * Display the makespan, work and peak resource usage of a schedule, followed by
+ * its concurrent peak, idle area and utilization over time (comma-separated
+ * percentages) with the utilization profile.
+ */
+static void print_sched_info_fields(Sched_info_t s){
+  int b;
+
+  printf("%.3f:%.3f:%d", s->makespan, s->work, s->peak_allocation);
+  if (utilization_profile){
+    printf(":%d:%.3f:", s->concurrent_peak, s->idle_area);
+    for (b = 0; b < UTILIZATION_BINS; b++)
+      printf(b ? ",%.0f" : "%.0f", s->utilization[b]);
+  }
+  printf("\n");
+}
 
-  best_makespan_nworkstations =
-      siList[get_best_makespan_index(nworkstations,
-          siList, cpa_work)]->nworkstations;
+/*
+ * Display the results of biCPA by retrieving the scheduling results from
+ * 'siList' for the respective number of workstations of the four variants of
+ * the biCPA algorithm. For comparison purposes, the results achieved by the
+ * seminal CPA algorithm (i.e., using the whole cluster to determine the tasks'
+ * allocations) are also displayed.
+ */
+void print_biCPA_result(BiCPA_result_t r) {
+  int i;
+  Sched_info_t *siList = r->siList;
 
-  get_non_dominated_schedules(&nno_dom, &no_dom_list, siList);
-  perfect_equity_nworkstations =
-      get_best_tradeoff_nworkstations(nno_dom, no_dom_list,
-          cpa_makespan, cpa_work, 1);
+  for (i = 0; i < r->nschedules; i++){
+    if (siList[i]->nworkstations == r->best_makespan_nworkstations){
+      printf("%.3f:%.3f:biCPA-M:%s:%s:", r->alloc_time, r->mapping_time,
+          platform_file, dagfile);
+      print_sched_info_fields(siList[i]);
+    }
+    if (siList[i]->nworkstations == r->best_work_nworkstations){
+      printf("%.3f:%.3f:biCPA-W:%s:%s:", r->alloc_time, r->mapping_time,
+          platform_file, dagfile);
+      print_sched_info_fields(siList[i]);
+    }
+    if (siList[i]->nworkstations == r->perfect_equity_nworkstations){
+      printf("%.3f:%.3f:biCPA-E:%s:%s:", r->alloc_time, r->mapping_time,
+          platform_file, dagfile);
+      print_sched_info_fields(siList[i]);
+    }
+    if (siList[i]->nworkstations == r->min_sum_nworkstations){
+      printf("%.3f:%.3f:biCPA-S:%s:%s:", r->alloc_time, r->mapping_time,
+          platform_file, dagfile);
+      print_sched_info_fields(siList[i]);
+    }
+    if (siList[i]->nworkstations == r->nworkstations){
+      printf("*****:*****:  CPA  :%s:%s:", platform_file, dagfile);
+      print_sched_info_fields(siList[i]);
+    }
+  }
+}
 
-  min_sum_nworkstations= get_best_tradeoff_nworkstations(nno_dom, no_dom_list,
-      cpa_makespan, cpa_work, 0);
+/*
+ * Determine only the allocations of the tasks for the sizes selected by the
+ * four variants and for the whole cluster, e.g., for results read from the
+ * result cache, without evaluating any schedule.
+ */
+void set_selected_allocations(xbt_dynar_t dag, BiCPA_result_t r){
+  int i, j, nsizes = 0, sizes[5];
+  const int selected[5] = { r->best_makespan_nworkstations,
+      r->best_work_nworkstations, r->perfect_equity_nworkstations,
+      r->min_sum_nworkstations, r->nworkstations };
+
+  /* Sizes have to be given in increasing order, without duplicates */
+  for (i = 0; i < 5; i++){
+    for (j = 0; j < nsizes && sizes[j] != selected[i]; j++)
+      ;
+    if (j < nsizes)
+      continue;
+    for (j = nsizes++; j > 0 && sizes[j-1] > selected[i]; j--)
+      sizes[j] = sizes[j-1];
+    sizes[j] = selected[i];
+  }
+  set_multiple_allocations(dag, nsizes, sizes);
+}
 
-  XBT_VERB("The four variants of biCPA assumes the following cluster sizes:");
-  XBT_VERB("  * biCPA-M: %d", best_makespan_nworkstations);
-  XBT_VERB("  * biCPA-W: %d", best_work_nworkstations);
-  XBT_VERB("  * biCPA-E: %d", perfect_equity_nworkstations);
-  XBT_VERB("  * biCPA-S: %d", min_sum_nworkstations);
+void free_biCPA_result(BiCPA_result_t r) {
+  int i;
 
-  mapping_time = get_time() - mapping_time;
+  for (i = 0; i < r->nschedules; i++)
+    free(r->siList[i]);
+  free(r->siList);
+  free(r);
+}
 
-  /*
-   * Display the output of the function by retrieving the scheduling results
-   * from 'siList' for the respective number of workstations of the four
-   * variants of the biCPA algorithm. For comparison purposes, the results
-   * achieved by the seminal CPA algorithm (i.e., using the whole cluster to
-   * determine the tasks' allocations) are also displayed.
-   */
-  for (i = 0; i < nworkstations; i++){
-    if (siList[i]->nworkstations == best_makespan_nworkstations)
-      printf("%.3f:%.3f:biCPA-M:%s:%s:%.3f:%.3f:%d\n", alloc_time, mapping_time,
-          platform_file, dagfile,
-          siList[i]->makespan,
-          siList[i]->work,
-          siList[i]->peak_allocation);
-    if (siList[i]->nworkstations == best_work_nworkstations)
-      printf("%.3f:%.3f:biCPA-W:%s:%s:%.3f:%.3f:%d\n", alloc_time, mapping_time,
-          platform_file, dagfile,
-          siList[i]->makespan,
-          siList[i]->work,
-          siList[i]->peak_allocation);
-    if (siList[i]->nworkstations == perfect_equity_nworkstations)
-      printf("%.3f:%.3f:biCPA-E:%s:%s:%.3f:%.3f:%d\n", alloc_time, mapping_time,
-          platform_file, dagfile,
-          siList[i]->makespan,
-          siList[i]->work,
-          siList[i]->peak_allocation);
-    if (siList[i]->nworkstations == min_sum_nworkstations)
-      printf("%.3f:%.3f:biCPA-S:%s:%s:%.3f:%.3f:%d\n", alloc_time, mapping_time,
-          platform_file, dagfile,
-          siList[i]->makespan,
-          siList[i]->work,
-          siList[i]->peak_allocation);
-    if (siList[i]->nworkstations == nworkstations)
-      printf("*****:*****:  CPA  :%s:%s:%.3f:%.3f:%d\n",
-          platform_file, dagfile,
-          siList[i]->makespan,
-          siList[i]->work,
-          siList[i]->peak_allocation);
-  }
+/*
+ * Schedule 'dag' with biCPA and display the results. They are also stored in
+ * the result cache, if any.
+ */
+void schedule_with_biCPA(xbt_dynar_t dag) {
+  BiCPA_result_t r = compute_biCPA(dag);
 
-  free(no_dom_list);
-  for (i=0; i < nworkstations; i++)
-    free(siList[i]);
-  free(siList);
+  print_biCPA_result(r);
+  result_cache_store(platform_file, dagfile, r);
+  free_biCPA_result(r);
 }
@@ -7,11 +7,76 @@
  *****************************************************************************/
 #include "simdag/simdag.h"
 #include "xbt.h"
+#include "arena.h"
+#include "dag.h"
+#include "dagcache.h"
+#include "dot.h"
+#include "graph.h"
+#include "simulator.h"
 #include "task.h"
 #include "workstation.h"
 
 XBT_LOG_NEW_DEFAULT_SUBCATEGORY(dag, biCPA, "Logging specific to dag");
 
+/*
+ * Load a DAG from a file in the DOT format, build its compact view, and set
+ * the initial bottom levels of its tasks (i.e., with one workstation per
+ * task). The platform has to be loaded beforehand. Files are read either by
+ * SD_PTG_dotload(), by the dedicated parser of the daggen subset of DOT, or
+ * through their binary form.
+ */
+xbt_dynar_t load_dag(const char *file){
+  unsigned int cursor;
+  SD_task_t task;
+  xbt_dynar_t dag;
+
+  if (dag_cache) {
+    dag = dag_cache_load(file, &graph);
+  } else if (fast_dot_parser) {
+    dag = fast_dotload(file, &graph);
+  } else {
+    dag = SD_PTG_dotload(file);
+    graph = graph_new(dag);
+  }
+
+  set_bottom_levels (dag);
+  graph_save_initial_state(graph);
+
+  if (XBT_LOG_ISENABLED(dag, xbt_log_priority_verbose)){
+    xbt_dynar_foreach(dag, cursor, task) {
+      if (SD_task_get_kind(task) != SD_TASK_COMM_PAR_MXN_1D_BLOCK)
+        XBT_VERB("%s: bl=%f",
+            SD_task_get_name(task), SD_task_get_bottom_level(task));
+    }
+  }
+  return dag;
+}
+
+/*
+ * Destroy a DAG and its compact view. The attributes of the workstations are
+ * set back to their initial values, so that another DAG can be scheduled on
+ * the same platform. The scheduling state of the DAG is released with the
+ * arenas, whose usage is reported, as well as the way the SimGrid simulations
+ * ordered the tasks on the workstations.
+ */
+void free_dag(xbt_dynar_t dag){
+  unsigned int cursor;
+  SD_task_t task;
+
+  graph_free(graph);
+  graph = NULL;
+  arena_reset(&schedule_arena);
+  arena_reset(&dag_arena);
+  arena_report(&schedule_arena);
+  arena_report(&dag_arena);
+  report_simgrid_sequencing();
+  xbt_dynar_foreach(dag, cursor, task) {
+    SD_task_destroy(task);
+  }
+  xbt_dynar_free_container(&dag);
+  reset_workstation_attributes();
+}
+
 /*
  * Get the dummy 'root' task of a DAG, i.e., the first task of the dynar.
  */
@@ -54,6 +119,62 @@ void set_bottom_levels (xbt_dynar_t dag){
   }
 }
 
+/*
+ * Update the values of the 'bottom level' attribute after the allocation of
+ * 'task' has been modified. Only the bottom levels of this task and of its
+ * ancestors can be impacted by such a modification. They are recomputed from
+ * the bottom levels of their children, starting from 'task' and going upwards.
+ * The propagation stops on a branch as soon as the bottom level of a task does
+ * not change. The 'marked' attribute indicates the tasks waiting to be updated,
+ * and a task is queued again if one of its children is modified afterwards. At
+ * the end, the values are thus the same as those set by set_bottom_levels().
+ * As a task is never queued twice at the same time, the queue is a circular
+ * buffer of 'ncompute' identifiers. The modified tasks are recorded in the
+ * compact view of the DAG (graph->updated).
+ */
+void update_bottom_levels (SD_task_t task){
+  int i, current, parent, first = 0, nqueued = 1;
+  int id = SD_task_get_id(task);
+  int *to_update = graph->scratch;
+  double bottom_level;
+
+  to_update[0] = id;
+  graph->attributes[id].marked = 1;
+  graph->nupdated = 0;
+  graph->update_stamp++;
+
+  while (nqueued){
+    current = to_update[first];
+    first = (first + 1) % graph->ncompute;
+    nqueued--;
+    graph->attributes[current].marked = 0;
+
+    bottom_level = bottom_level_local_computation(graph->tasks[current]);
+    if (current != id &&
+        bottom_level == graph->attributes[current].bottom_level)
+      continue;
+
+    graph->attributes[current].bottom_level = bottom_level;
+    XBT_DEBUG("%s's bottom level is updated to %f",
+        SD_task_get_name(graph->tasks[current]), bottom_level);
+    if (graph->update_stamps[current] != graph->update_stamp){
+      graph->update_stamps[current] = graph->update_stamp;
+      graph->updated[graph->nupdated++] = current;
+    }
+
+    /* Queue the compute parents of the modified task */
+    for (i = graph->parent_index[current]; i < graph->parent_index[current+1];
+        i++){
+      parent = graph->parents[i];
+      if (!graph->attributes[parent].marked){
+        graph->attributes[parent].marked = 1;
+        to_update[(first + nqueued) % graph->ncompute] = parent;
+        nqueued++;
+      }
+    }
+  }
+}
+
 /*
  * Compute and set values of the 'top level' attribute of the tasks that
  * compose a DAG.
@@ -110,18 +231,114 @@ void set_precedence_levels (xbt_dynar_t dag){
 /**************               Accounting functions              **************/
 /*****************************************************************************/
 /*****************************************************************************/
+/*
+ * Compute the sum of the areas of the compute tasks on their current
+ * allocations. Areas are estimated all at once, then summed in the order of
+ * the task identifiers.
+ */
 double compute_total_work (xbt_dynar_t dag){
-  unsigned int i;
+  int i;
   double total_work = 0.0;
-  SD_task_t task;
 
-  xbt_dynar_foreach(dag, i, task){
-    if (SD_task_get_kind(task) == SD_TASK_COMP_PAR_AMDAHL){
-      total_work += SD_task_estimate_area(task,
-          SD_task_get_allocation_size(task));
+  for (i = 0; i < graph->ncompute; i++)
+    graph->scratch[i] = graph->attributes[i].allocation_size;
+
+  SD_task_estimate_areas(graph->ncompute, NULL, graph->scratch,
+      graph->estimates);
+
+  for (i = 0; i < graph->ncompute; i++)
+    total_work += graph->estimates[i];
+
+  return total_work;
+}
+
+/*
+ * Sweep-line accountant of the utilization of the workstations by the current
+ * schedule. When SimGrid gave the makespan, the start and finish times of the
+ * compute tasks are the simulated ones, relative to the start of the
+ * simulation, which have to be read before reset_simulation(). Otherwise, i.e.,
+ * in estimate-only mode or with the native engine, they are the times
+ * estimated by map_allocations(). The start and finish events of the tasks are
+ * sorted by date, finish events first on ties so that workstations released at
+ * a date are reused at once, and swept while maintaining the number of busy
+ * workstations. Return the peak of this number, i.e., the number of
+ * workstations actually busy at the same time. The area of the tasks is set in
+ * 'busy_area', and the utilization of the peak number of workstations during
+ * 'nbins' intervals of equal length of the 'makespan', in percent, in
+ * 'utilization'.
+ */
+typedef struct _UsageEvent {
+  double date;
+  int delta;
+} UsageEvent;
+
+static int dateCompareUsageEvents(const void *e1, const void *e2){
+  const UsageEvent *event1 = (const UsageEvent*) e1;
+  const UsageEvent *event2 = (const UsageEvent*) e2;
+
+  if (event1->date < event2->date)
+    return -1;
+  else if (event1->date > event2->date)
+    return 1;
+  else
+    return event1->delta - event2->delta;
+}
+
+int compute_utilization_profile(int nbins, double makespan,
+    double *utilization, double *busy_area){
+  int i, b, size, nevents = 0, busy = 0, peak = 0;
+  int simulated = simgrid_gives_makespan();
+  double start, finish, length, from, to;
+  UsageEvent *events;
+
+  events = (UsageEvent*) arena_alloc(&schedule_arena,
+      2 * graph->ncompute * sizeof(UsageEvent));
+  *busy_area = 0.0;
+  for (i = 0; i < graph->ncompute; i++){
+    if (simulated){
+      start = SD_task_get_start_time(graph->tasks[i]) -
+          get_simgrid_start_clock();
+      finish = SD_task_get_finish_time(graph->tasks[i]) -
+          get_simgrid_start_clock();
+    } else {
+      start = graph->attributes[i].estimated_start_time;
+      finish = graph->attributes[i].estimated_finish_time;
     }
+    size = graph->attributes[i].allocation_size;
+    if (!graph->attributes[i].allocation || finish <= start)
+      continue;
+    events[nevents].date = start;
+    events[nevents++].delta = size;
+    events[nevents].date = finish;
+    events[nevents++].delta = -size;
+    *busy_area += size * (finish - start);
   }
-  return total_work;
+  qsort(events, nevents, sizeof(UsageEvent), dateCompareUsageEvents);
+
+  for (b = 0; b < nbins; b++)
+    utilization[b] = 0.0;
+  length = makespan / nbins;
+
+  for (i = 0; i < nevents; i++){
+    /* Spread the busy area since the previous event over the intervals */
+    if (busy && length > 0.){
+      from = events[i-1].date;
+      to = events[i].date;
+      for (b = MIN((int) (from / length), nbins - 1); from < to; b++){
+        finish = (b == nbins - 1) ? to : MIN(to, (b + 1) * length);
+        if (finish > from)
+          utilization[b] += busy * (finish - from);
+        from = MAX(from, finish);
+      }
+    }
+    busy += events[i].delta;
+    peak = MAX(peak, busy);
+  }
+
+  for (b = 0; b < nbins; b++)
+    if (peak && length > 0.)
+      utilization[b] = 100. * utilization[b] / (peak * length);
+  return peak;
 }
 /*****************************************************************************/
 /*****************************************************************************/
@@ -150,35 +367,105 @@ void set_allocations_from_iteration(xbt_dynar_t dag, int index){
   }
 }
 
+/*
+ * Add a resource dependency between two tasks mapped one after the other on a
+ * workstation, if it doesn't exist yet, and record it to remove it before the
+ * next schedule.
+ */
+static void add_resource_dependency(SD_task_t before, SD_task_t after){
+  if (!before || !after || SD_task_dependency_exists(before, after))
+    return;
+  SD_task_dependency_add("resource", NULL, before, after);
+  graph_add_resource_edge(graph, SD_task_get_id(before), SD_task_get_id(after));
+}
+
+/*
+ * Backfilling version of the mapping of a task. The task may start in the
+ * idle gaps left on the workstations by the tasks mapped before it, as long as
+ * all its workstations are idle from its start to its finish. As the data
+ * arrival time depends on the selected workstations, a set found in gaps is
+ * only kept if the data arrive before it is available. Otherwise, another set
+ * is looked for from the data arrival time on. The estimated start time and
+ * finish time are set, and the task is inserted in the timeline of each of its
+ * workstations, between the tasks between which resource dependencies are
+ * added when SimGrid simulates the schedule.
+ */
+static void backfill_task(SD_task_t task){
+  int j, allocation_size = SD_task_get_allocation_size(task), in_gaps;
+  double time, duration, available, start;
+  SD_workstation_t *allocation;
+  SD_task_t *before, *after;
+
+  time = SD_task_estimate_minimal_start_time(task);
+  duration = SD_task_estimate_execution_time(task, allocation_size);
+  do {
+    allocation = get_backfilling_workstation_set(time, allocation_size,
+        duration, &available, &in_gaps);
+    SD_task_set_allocation(task, allocation);
+    start = MAX(SD_task_estimate_last_data_arrival_time(task), available);
+    time = start;
+  } while (in_gaps && start > available);
+
+  if (simgrid_engine_is_used())
+    SD_task_schedulev(task, allocation_size, allocation);
+
+  SD_task_set_estimated_start_time(task, start);
+  SD_task_set_estimated_finish_time(task, start + duration);
+
+  before = (SD_task_t*) arena_alloc(&schedule_arena,
+      allocation_size * sizeof(SD_task_t));
+  after = (SD_task_t*) arena_alloc(&schedule_arena,
+      allocation_size * sizeof(SD_task_t));
+  backfill_workstation_set(task, allocation_size, allocation, start,
+      start + duration, before, after);
+
+  if (simgrid_engine_is_used())
+    for (j = 0; j < allocation_size; j++){
+      add_resource_dependency(before[j], task);
+      add_resource_dependency(task, after[j]);
+    }
+
+  XBT_VERB("Just backfilled task '%s' on %d workstation (first is '%s')",
+      SD_task_get_name(task), allocation_size,
+      SD_workstation_get_name(allocation[0]));
+  XBT_VERB("   Estimated [Start-Finish] time interval = [%.3f - %.3f]",
+      start, start + duration);
+}
+
 /*
  * Build a schedule from a given allocation of the different tasks in the DAG.
+ * Return the estimated makespan of this schedule, i.e., the latest estimated
+ * finish time of the compute tasks.
+ * With backfilling, the tasks are eventually sorted by estimated start time,
+ * which is the order of the tasks on each workstation.
  */
 
-void map_allocations(xbt_dynar_t dag){
+double map_allocations(xbt_dynar_t dag){
   unsigned int i, j;
   int allocation_size;
   double min_start_time,last_data_arrival, earliest_availability;
+  double estimated_makespan = 0.0;
   SD_workstation_t * allocation = NULL;
-  SD_task_t task, root = get_dag_root(dag);
-
-  /* Schedule Root */
-  if (SD_task_get_state(root) == SD_NOT_SCHEDULED) {
-    XBT_DEBUG("Scheduling '%s'", SD_task_get_name(root));
-    SD_task_schedulel(root, 1, SD_workstation_get_list());
-    SD_task_set_estimated_finish_time(root, 0.0);
-  }
+  SD_task_t task;
 
   /* Recompute the bottom level values using the current allocations of the
    * tasks. Then sort the tasks by decreasing bottom level values. This ensures
    * to schedule the most priority tasks first and respect the precedence
-   * constraints.
+   * constraints. 'root' has the biggest bottom level, hence it is scheduled
+   * first, like any other compute task, whatever its initial state.
    */
   set_bottom_levels(dag);
   xbt_dynar_sort(dag, bottomLevelCompareTasks);
 
-  xbt_dynar_foreach(dag, i, task){
-    if (SD_task_get_kind(task) == SD_TASK_COMP_PAR_AMDAHL){
+  if (backfilling)
+    reset_gap_index();
 
+  xbt_dynar_foreach(dag, i, task){
+    if (SD_task_get_kind(task) == SD_TASK_COMP_PAR_AMDAHL && backfilling){
+      backfill_task(task);
+      estimated_makespan = MAX(estimated_makespan,
+          SD_task_get_estimated_finish_time(task));
+    } else if (SD_task_get_kind(task) == SD_TASK_COMP_PAR_AMDAHL){
       /* Estimate the minimal start time of the current task. It depends on the
        * finish time of all its compute predecessors. From this value, the set
        * of workstations onto which the task will be mapped is determined. It
@@ -187,7 +474,8 @@ void map_allocations(xbt_dynar_t dag){
        * date, if needed.
        */
       min_start_time = SD_task_estimate_minimal_start_time(task);
-      allocation = get_best_workstation_set(min_start_time);
+      allocation = get_best_workstation_set(min_start_time,
+          SD_task_get_allocation_size(task));
       SD_task_set_allocation(task, allocation);
 
       allocation_size =  SD_task_get_allocation_size(task);
@@ -196,8 +484,11 @@ void map_allocations(xbt_dynar_t dag){
        * tasks are schedule. Transfer tasks are automatically scheduled when
        * both parent and child are scheduled. If one of these two tasks is not
        * scheduled yet, sender or receiver information are set.
+       * The native simulator directly uses the allocation of the task, hence
+       * this is only needed when SimGrid simulates the schedule.
        */
-      SD_task_schedulev(task, allocation_size, allocation);
+      if (simgrid_engine_is_used())
+        SD_task_schedulev(task, allocation_size, allocation);
 
       /* As the scheduling is built off-line, information has to be maintained
        * such as the estimation of the start and finish time of the task on its
@@ -214,9 +505,13 @@ void map_allocations(xbt_dynar_t dag){
       earliest_availability =
           get_best_workstation_set_earliest_availability(allocation_size,
           allocation),
+      SD_task_set_estimated_start_time(task,
+          MAX(last_data_arrival, earliest_availability));
       SD_task_set_estimated_finish_time(task,
-          MAX(last_data_arrival, earliest_availability)
+          SD_task_get_estimated_start_time(task)
           + SD_task_estimate_execution_time(task, allocation_size));
+      estimated_makespan = MAX(estimated_makespan,
+          SD_task_get_estimated_finish_time(task));
 
       XBT_VERB("Just scheduled task '%s' on %d workstation (first is '%s')",
           SD_task_get_name(task), allocation_size,
@@ -246,54 +541,59 @@ void map_allocations(xbt_dynar_t dag){
          * on the given workstation. Each time a task is mapped, a dependency is
          * added from the last task scheduled on this workstation, if it doesn't
          * exist yet. This is done thanks to the 'last_scheduled_task' attribute
-         * of the workstations.*/
-        if (SD_workstation_get_last_scheduled_task(allocation[j]) &&
-            !SD_task_dependency_exists(
-                SD_workstation_get_last_scheduled_task(allocation[j]),task))
-          SD_task_dependency_add("resource", NULL,
+         * of the workstations. The native simulator builds these chains by
+         * itself.*/
+        if (simgrid_engine_is_used())
+          add_resource_dependency(
               SD_workstation_get_last_scheduled_task(allocation[j]), task);
 
         SD_workstation_set_last_scheduled_task(allocation[j], task);
       }
-      free(allocation);
     }
   }
+  if (backfilling)
+    xbt_dynar_sort(dag, startTimeCompareTasks);
+  return estimated_makespan;
 }
 /*
  * biCPA relies on the makespan and work values achieved with different
  * allocations. Determining these values requires to run several simulations one
  * after the other. Some parameters have to be reset between each of these
  * simulation runs:
- *   - Resource dependencies that have been added are removed
- *   - Attributes attached to workstations are reset to their initial values
- *     (i.e., available_at = 0. and last_scheduled_task = NULL)
+ *   - Resource dependencies that have been added are removed. They are
+ *     recorded by map_allocations(), so that only them are browsed.
+ *   - Attributes attached to the workstations used by the schedule are
+ *     restored to their initial values (i.e., available_at = 0. and
+ *     last_scheduled_task = NULL)
  *   - Internal SimDag parameters related to tasks are reinitialized (task's
  *     state and number of dependencies to satisfy mainly)
+ *   - The scheduling state of the schedule (allocations of the tasks, work
+ *     arrays) is released at once with its arena
  */
 void reset_simulation (xbt_dynar_t dag) {
-  unsigned int i,j;
-  SD_task_t task, parent;
-  xbt_dynar_t parents;
+  int i;
+  SD_task_t parent, task;
+
+  for (i = 0; i < graph->ncompute; i++)
+    graph->attributes[i].allocation = NULL;
+  arena_reset(&schedule_arena);
+  restore_workstation_attributes();
+
+  /* Only the attributes of the workstations matter to the native simulator */
+  if (!simgrid_engine_is_used())
+    return;
 
   /*
    * Let's remove the resource dependencies that have been added by the
    * previous simulation round.
    */
-  xbt_dynar_foreach(dag, i, task){
-    parents = SD_task_get_parents(task);
-    xbt_dynar_foreach(parents, j, parent){
-      if (SD_task_get_kind(parent) == SD_TASK_COMP_PAR_AMDAHL){
-        if (SD_task_dependency_exists(parent, task) &&
-            (SD_task_dependency_get_name(parent,task)) &&
-            (!strcmp(SD_task_dependency_get_name(parent,task), "resource"))){
-          XBT_DEBUG("Remove resource dependency between tasks '%s' and '%s'",
-              SD_task_get_name(parent), SD_task_get_name(task));
-          SD_task_dependency_remove(parent, task);
-        }
-      }
-    }
-    xbt_dynar_free_container(&parents);
+  for (i = 0; i < graph->nresource_edges; i++){
+    parent = graph->tasks[graph->resource_edges[2 * i]];
+    task = graph->tasks[graph->resource_edges[2 * i + 1]];
+    XBT_DEBUG("Remove resource dependency between tasks '%s' and '%s'",
+        SD_task_get_name(parent), SD_task_get_name(task));
+    SD_task_dependency_remove(parent, task);
   }
-  reset_workstation_attributes();
+  graph->nresource_edges = 0;
   SD_application_reinit();
 }
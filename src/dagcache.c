@@ -0,0 +1,325 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "simdag/simdag.h"
+#include "xbt.h"
+#include "dagcache.h"
+#include "dot.h"
+#include "graph.h"
+#include "timer.h"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(dagcache, biCPA,
+    "Logging specific to binary DAGs");
+
+/*
+ * Binary form of a DAG file, written next to it. It is made of a header
+ * followed by sections, in the native byte order:
+ *   - amounts[nnodes], alphas[nnodes]: Amdahl's law parameters of the tasks;
+ *   - sizes[nedges]: amounts of data of the edges (0 for control ones);
+ *   - sources[nedges], destinations[nedges]: nodes of the edges, in their
+ *     order in the DOT file, so that the tasks and dependencies are created in
+ *     the same order as when the DOT file is parsed. The edges are thus not
+ *     stored in compressed sparse row format, which is built at load time;
+ *   - name_offsets[nnodes], names[names_size]: names of the tasks, as
+ *     null-terminated strings.
+ * The header records the size, modification time and a hash of the content of
+ * the DOT file the binary form comes from, so that an outdated binary form is
+ * detected. The file is mapped in memory, and its sections are used in place.
+ */
+#define DAG_CACHE_MAGIC   "biCPAdag"
+#define DAG_CACHE_VERSION 3
+
+typedef struct _DagCacheHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t nnodes;
+  int32_t nedges;
+  uint32_t names_size;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t source_hash;
+} DagCacheHeader;
+
+typedef struct _DagCacheSections {
+  const double *amounts;
+  const double *alphas;
+  const double *sizes;
+  const int32_t *sources;
+  const int32_t *destinations;
+  const int32_t *name_offsets;
+  const char *names;
+} DagCacheSections;
+
+static size_t dag_cache_size(const DagCacheHeader *header){
+  return sizeof(DagCacheHeader) +
+      (2 * (size_t) header->nnodes + header->nedges) * sizeof(double) +
+      ((size_t) header->nnodes + 2 * (size_t) header->nedges) *
+      sizeof(int32_t) +
+      header->names_size;
+}
+
+static void dag_cache_get_sections(const char *content, DagCacheSections *s){
+  const DagCacheHeader *header = (const DagCacheHeader*) content;
+
+  s->amounts = (const double*) (content + sizeof(DagCacheHeader));
+  s->alphas = s->amounts + header->nnodes;
+  s->sizes = s->alphas + header->nnodes;
+  s->sources = (const int32_t*) (s->sizes + header->nedges);
+  s->destinations = s->sources + header->nedges;
+  s->name_offsets = s->destinations + header->nedges;
+  s->names = (const char*) (s->name_offsets + header->nnodes);
+}
+
+/*
+ * Is 'content' a complete binary DAG of the current version?
+ */
+static int dag_cache_is_valid(const char *content, size_t size){
+  const DagCacheHeader *header = (const DagCacheHeader*) content;
+
+  return content && size >= sizeof(DagCacheHeader) &&
+      !memcmp(header->magic, DAG_CACHE_MAGIC, sizeof(header->magic)) &&
+      header->version == DAG_CACHE_VERSION &&
+      header->nnodes >= 0 && header->nedges >= 0 &&
+      size == dag_cache_size(header);
+}
+
+/*
+ * Does the valid binary DAG 'content', written at 'binary_mtime', come from the
+ * DOT file described by 'source'? This cheap check only compares the size and
+ * modification time of the DOT file with those recorded in the header. It is
+ * not trusted when the DOT file was modified in the second the binary form was
+ * written, as a later modification in that second would go unnoticed.
+ */
+static int dag_cache_is_up_to_date(const char *content,
+    const struct stat *source, time_t binary_mtime){
+  const DagCacheHeader *header = (const DagCacheHeader*) content;
+
+  return header->source_size == (uint64_t) source->st_size &&
+      header->source_mtime == (int64_t) source->st_mtime &&
+      source->st_mtime < binary_mtime;
+}
+
+/*
+ * Write the binary form of a DAG description. The file is written under a
+ * temporary name first, then renamed, so that concurrent readers and writers
+ * never see a partial file. Return 0 on failure.
+ */
+static int dag_cache_write(const char *binary_file, DagDescription d,
+    const struct stat *source, uint64_t source_hash){
+  int i, e, fd, written;
+  int32_t *sources, *destinations, *name_offsets;
+  char *temporary_file;
+  FILE *output;
+  DagCacheHeader header;
+
+  memset(&header, 0, sizeof(DagCacheHeader));
+  memcpy(header.magic, DAG_CACHE_MAGIC, sizeof(header.magic));
+  header.version = DAG_CACHE_VERSION;
+  header.nnodes = d->nnodes;
+  header.nedges = d->nedges;
+  header.source_size = source->st_size;
+  header.source_mtime = source->st_mtime;
+  header.source_hash = source_hash;
+
+  sources = (int32_t*) calloc (d->nedges, sizeof(int32_t));
+  destinations = (int32_t*) calloc (d->nedges, sizeof(int32_t));
+  name_offsets = (int32_t*) calloc (d->nnodes, sizeof(int32_t));
+
+  for (e = 0; e < d->nedges; e++){
+    sources[e] = d->sources[e];
+    destinations[e] = d->destinations[e];
+  }
+
+  for (i = 0; i < d->nnodes; i++){
+    name_offsets[i] = header.names_size;
+    header.names_size += strlen(d->names[i]) + 1;
+  }
+
+  temporary_file = bprintf("%s.XXXXXX", binary_file);
+  fd = mkstemp(temporary_file);
+  if (fd >= 0)
+    fchmod(fd, 0644);
+  output = (fd >= 0) ? fdopen(fd, "w") : NULL;
+  written = (output != NULL);
+  if (output){
+    written =
+        fwrite(&header, sizeof(DagCacheHeader), 1, output) == 1 &&
+        fwrite(d->amounts, sizeof(double), d->nnodes, output) == d->nnodes &&
+        fwrite(d->alphas, sizeof(double), d->nnodes, output) == d->nnodes &&
+        fwrite(d->sizes, sizeof(double), d->nedges, output) == d->nedges &&
+        fwrite(sources, sizeof(int32_t), d->nedges, output) == d->nedges &&
+        fwrite(destinations, sizeof(int32_t), d->nedges, output) ==
+            d->nedges &&
+        fwrite(name_offsets, sizeof(int32_t), d->nnodes, output) == d->nnodes;
+    for (i = 0; written && i < d->nnodes; i++)
+      written = fwrite(d->names[i], strlen(d->names[i]) + 1, 1, output) == 1;
+    written = !fclose(output) && written && !rename(temporary_file,
+        binary_file);
+  }
+  if (fd >= 0 && !written)
+    unlink(temporary_file);
+
+  free(temporary_file);
+  free(sources);
+  free(destinations);
+  free(name_offsets);
+  return written;
+}
+
+/*
+ * Create the DAG stored in a valid binary form. The description of the DAG
+ * points to the sections of the mapped file, except for the names of the tasks
+ * that are rebuilt from the offsets. The offsets and nodes are checked.
+ */
+static xbt_dynar_t dag_cache_create(const char *binary_file,
+    const char *content, Graph *g, int *nnodes, int *nedges){
+  int i, e;
+  const DagCacheHeader *header = (const DagCacheHeader*) content;
+  DagCacheSections s;
+  struct _DagDescription d;
+  xbt_dynar_t dag;
+
+  dag_cache_get_sections(content, &s);
+
+  d.nnodes = header->nnodes;
+  d.nedges = header->nedges;
+  d.amounts = (double*) s.amounts;
+  d.alphas = (double*) s.alphas;
+  d.sizes = (double*) s.sizes;
+  d.sources = (int*) s.sources;
+  d.destinations = (int*) s.destinations;
+  d.names = (char**) calloc (d.nnodes, sizeof(char*));
+
+  xbt_assert(!header->names_size || !s.names[header->names_size - 1],
+      "Corrupted binary DAG '%s'", binary_file);
+  for (i = 0; i < d.nnodes; i++){
+    xbt_assert(s.name_offsets[i] >= 0 &&
+        s.name_offsets[i] < header->names_size,
+        "Corrupted binary DAG '%s'", binary_file);
+    d.names[i] = (char*) s.names + s.name_offsets[i];
+  }
+
+  for (e = 0; e < d.nedges; e++)
+    xbt_assert(s.sources[e] >= 0 && s.sources[e] < d.nnodes &&
+        s.destinations[e] >= 0 && s.destinations[e] < d.nnodes,
+        "Corrupted binary DAG '%s'", binary_file);
+
+  dag = dag_description_load(&d, g);
+  *nnodes = d.nnodes;
+  *nedges = d.nedges;
+
+  free(d.names);
+  return dag;
+}
+
+/*
+ * Load a DAG file through its binary form. The binary form is used when the
+ * size and modification time of the DOT file match those it records, without
+ * reading the DOT file. Otherwise, it is still used if the size and content
+ * hash of the DOT file match. If the binary form is missing, or does not match
+ * the current content of the DOT file, the DOT file is parsed and its binary
+ * form is written for the next runs.
+ */
+xbt_dynar_t dag_cache_load(const char *file, Graph *g){
+  int nnodes, nedges, up_to_date = 0;
+  double load_time;
+  size_t source_size = 0, size = 0;
+  uint64_t source_hash = 0;
+  char *source = NULL, *content = NULL, *binary_file;
+  struct _DagDescription description;
+  struct stat source_stat, binary_stat;
+  xbt_dynar_t dag;
+
+  load_time = get_time();
+  xbt_assert(!stat(file, &source_stat), "Cannot read DAG file '%s'", file);
+  binary_file = bprintf("%s%s", file, DAG_CACHE_SUFFIX);
+
+  if (!stat(binary_file, &binary_stat) &&
+      map_file(binary_file, &content, &size) &&
+      dag_cache_is_valid(content, size)){
+    up_to_date = dag_cache_is_up_to_date(content, &source_stat,
+        binary_stat.st_mtime);
+    if (!up_to_date){
+      xbt_assert(map_file(file, &source, &source_size),
+          "Cannot read DAG file '%s'", file);
+      source_hash = hash_content(source, source_size);
+      up_to_date =
+          ((const DagCacheHeader*) content)->source_size == source_size &&
+          ((const DagCacheHeader*) content)->source_hash == source_hash;
+    }
+  }
+
+  if (up_to_date){
+    unmap_file(source, source_size);
+    dag = dag_cache_create(binary_file, content, g, &nnodes, &nedges);
+    unmap_file(content, size);
+    XBT_VERB("'%s': %d tasks and %d edges loaded from '%s' in %.3f seconds",
+        file, nnodes, nedges, binary_file, get_time() - load_time);
+  } else {
+    unmap_file(content, size);
+    if (!source){
+      xbt_assert(map_file(file, &source, &source_size),
+          "Cannot read DAG file '%s'", file);
+      source_hash = hash_content(source, source_size);
+    }
+    memset(&description, 0, sizeof(struct _DagDescription));
+    dot_parse_content(file, source, source_size, &description);
+    unmap_file(source, source_size);
+    if (!dag_cache_write(binary_file, &description, &source_stat,
+        source_hash))
+      XBT_WARN("Cannot write binary DAG '%s'", binary_file);
+    dag = dag_description_load(&description, g);
+    XBT_VERB("'%s': %d tasks and %d edges parsed in %.3f seconds, binary form "
+        "written to '%s'", file, description.nnodes, description.nedges,
+        get_time() - load_time, binary_file);
+    dag_description_free(&description);
+  }
+
+  free(binary_file);
+  return dag;
+}
+
+/*
+ * Write the binary form of a DOT file in 'binary_file', or next to the DOT
+ * file if NULL. Return 0 on failure.
+ */
+int convert_dag(const char *file, const char *binary_file){
+  int written;
+  size_t source_size;
+  char *source, *default_file = NULL;
+  struct _DagDescription description;
+  struct stat source_stat;
+
+  if (stat(file, &source_stat) || !map_file(file, &source, &source_size)){
+    XBT_ERROR("Cannot read DAG file '%s'", file);
+    return 0;
+  }
+  if (!binary_file)
+    binary_file = default_file = bprintf("%s%s", file, DAG_CACHE_SUFFIX);
+
+  memset(&description, 0, sizeof(struct _DagDescription));
+  dot_parse_content(file, source, source_size, &description);
+  written = dag_cache_write(binary_file, &description, &source_stat,
+      hash_content(source, source_size));
+  unmap_file(source, source_size);
+
+  if (written)
+    XBT_INFO("'%s': %d tasks and %d edges written to '%s'", file,
+        description.nnodes, description.nedges, binary_file);
+  else
+    XBT_ERROR("Cannot write binary DAG '%s'", binary_file);
+
+  dag_description_free(&description);
+  free(default_file);
+  return written;
+}
@@ -0,0 +1,635 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "simdag/simdag.h"
+#include "xbt.h"
+#include "dot.h"
+#include "graph.h"
+#include "timer.h"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(dot, biCPA, "Logging specific to DOT parser");
+
+/*
+ * Single-pass parser for the subset of the DOT language produced by daggen:
+ *   digraph G {
+ *     1 [size="49659735022", alpha="0.19"]
+ *     2 -> 4 [size ="411041792"]
+ *   }
+ * Node statements give the amount of computation ('size') and the
+ * non-parallelizable fraction ('alpha') of a task. Edge statements may give the
+ * amount of data to transfer ('size'). Other attributes, comments, and the
+ * 'graph', 'node', and 'edge' statements are skipped. Identifiers are either
+ * quoted or made of letters, digits, '_' and '.'.
+ *
+ * The file is mapped in memory and read once. Nodes and edges are stored in
+ * the arrays of a DAG description, then the SimDag tasks and dependencies are
+ * created as SD_PTG_dotload() does, and the compact view of the DAG is directly
+ * built from the list of edges.
+ */
+
+/* Token types */
+#define DOT_EOF    0
+#define DOT_ID     1
+#define DOT_ARROW  2
+#define DOT_SYMBOL 3
+
+typedef struct _DotParser *DotParser;
+struct _DotParser {
+  const char *file;
+  const char *current;
+  const char *end;
+  int line;
+
+  /* Last token read, and its first character (quotes included) */
+  int type;
+  const char *start;
+  const char *token;
+  int length;
+
+  /* Nodes and edges read so far */
+  DagDescription dag;
+
+  /* Allocated nodes, and hash table of their names (-1 for empty slots) */
+  int nodes_size;
+  int table_size;
+  int *table;
+
+  /* Allocated edges, and hash table of (source, destination) pairs */
+  int edges_size;
+  int edge_table_size;
+  int *edge_table;
+};
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************                      Lexer                      **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/* Character classes, without the locale-dependent functions of ctype.h */
+static int is_blank(char c){
+  return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static int is_digit(char c){
+  return c >= '0' && c <= '9';
+}
+
+static int is_id_char(char c){
+  return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      c == '_' || c == '.';
+}
+
+static void dot_skip_blanks(DotParser p){
+  while (p->current < p->end){
+    if (*p->current == '\n'){
+      p->line++;
+      p->current++;
+    } else if (is_blank(*p->current)){
+      p->current++;
+    } else if (*p->current == '#' ||
+        (*p->current == '/' && p->current + 1 < p->end &&
+            p->current[1] == '/')){
+      while (p->current < p->end && *p->current != '\n')
+        p->current++;
+    } else if (*p->current == '/' && p->current + 1 < p->end &&
+        p->current[1] == '*'){
+      for (p->current += 2; p->current + 1 < p->end &&
+          !(p->current[0] == '*' && p->current[1] == '/'); p->current++)
+        if (*p->current == '\n')
+          p->line++;
+      xbt_assert(p->current + 1 < p->end, "%s:%d: unterminated comment",
+          p->file, p->line);
+      p->current += 2;
+    } else {
+      break;
+    }
+  }
+}
+
+/* Read the next token. The content of quoted identifiers excludes quotes. */
+static int dot_next(DotParser p){
+  dot_skip_blanks(p);
+  p->start = p->token = p->current;
+  p->length = 0;
+
+  if (p->current >= p->end){
+    p->type = DOT_EOF;
+  } else if (*p->current == '"'){
+    p->token = ++p->current;
+    while (p->current < p->end && *p->current != '"'){
+      if (*p->current == '\n')
+        p->line++;
+      p->current++;
+    }
+    xbt_assert(p->current < p->end, "%s:%d: unterminated string", p->file,
+        p->line);
+    p->length = p->current++ - p->token;
+    p->type = DOT_ID;
+  } else if (is_id_char(*p->current) ||
+      (*p->current == '-' && p->current + 1 < p->end &&
+          is_digit(p->current[1]))){
+    p->current++;
+    while (p->current < p->end && is_id_char(*p->current))
+      p->current++;
+    p->length = p->current - p->token;
+    p->type = DOT_ID;
+  } else if (*p->current == '-' && p->current + 1 < p->end &&
+      p->current[1] == '>'){
+    p->current += 2;
+    p->length = 2;
+    p->type = DOT_ARROW;
+  } else {
+    p->length = 1;
+    p->current++;
+    p->type = DOT_SYMBOL;
+  }
+  return p->type;
+}
+
+static int dot_is_symbol(DotParser p, char symbol){
+  return p->type == DOT_SYMBOL && *p->token == symbol;
+}
+
+static int dot_is_keyword(DotParser p, const char *keyword){
+  return p->type == DOT_ID && p->length == strlen(keyword) &&
+      !strncmp(p->token, keyword, p->length);
+}
+
+/*
+ * Convert the current token to a number. Integers that are exactly represented
+ * by a double are converted directly, other numbers by atof().
+ */
+static double dot_get_number(DotParser p){
+  int i;
+  char buffer[64];
+  double value = 0.0;
+
+  xbt_assert(p->type == DOT_ID && p->length < sizeof(buffer),
+      "%s:%d: number expected", p->file, p->line);
+
+  for (i = 0; i < p->length && is_digit(p->token[i]); i++)
+    value = 10 * value + (p->token[i] - '0');
+  if (i == p->length && i > 0 && i < 16)
+    return value;
+
+  memcpy(buffer, p->token, p->length);
+  buffer[p->length] = '\0';
+  return atof(buffer);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************                 Nodes and edges                 **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/* FNV-1a hash function */
+static unsigned long dot_hash(const char *bytes, int length){
+  int i;
+  unsigned long hash = 2166136261UL;
+
+  for (i = 0; i < length; i++){
+    hash ^= (unsigned char) bytes[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+static void dot_grow_node_table(DotParser p){
+  int i, k;
+  DagDescription d = p->dag;
+
+  free(p->table);
+  p->table_size = p->table_size ? 2 * p->table_size : 1024;
+  p->table = (int*) malloc (p->table_size * sizeof(int));
+  memset(p->table, -1, p->table_size * sizeof(int));
+
+  for (i = 0; i < d->nnodes; i++){
+    k = dot_hash(d->names[i], strlen(d->names[i])) & (p->table_size - 1);
+    while (p->table[k] >= 0)
+      k = (k + 1) & (p->table_size - 1);
+    p->table[k] = i;
+  }
+}
+
+/*
+ * Return the index of the node named as the current token. As in DOT, a node
+ * that is not declared yet is created, without computation.
+ */
+static int dot_get_node(DotParser p){
+  int k;
+  DagDescription d = p->dag;
+
+  k = dot_hash(p->token, p->length) & (p->table_size - 1);
+  while (p->table[k] >= 0){
+    if (!strncmp(d->names[p->table[k]], p->token, p->length) &&
+        !d->names[p->table[k]][p->length])
+      return p->table[k];
+    k = (k + 1) & (p->table_size - 1);
+  }
+
+  if (d->nnodes == p->nodes_size){
+    p->nodes_size = p->nodes_size ? 2 * p->nodes_size : 1024;
+    d->names = (char**) realloc (d->names, p->nodes_size * sizeof(char*));
+    d->amounts = (double*) realloc (d->amounts,
+        p->nodes_size * sizeof(double));
+    d->alphas = (double*) realloc (d->alphas, p->nodes_size * sizeof(double));
+  }
+  d->names[d->nnodes] = strndup(p->token, p->length);
+  d->amounts[d->nnodes] = 0.0;
+  d->alphas[d->nnodes] = 0.0;
+  p->table[k] = d->nnodes++;
+
+  /* Keep the load factor of the hash table under 1/2 */
+  if (2 * d->nnodes > p->table_size)
+    dot_grow_node_table(p);
+
+  return d->nnodes - 1;
+}
+
+static unsigned long dot_hash_edge(int source, int destination){
+  return ((unsigned long) source * 2654435761UL) ^
+      ((unsigned long) destination * 40503UL);
+}
+
+static void dot_grow_edge_table(DotParser p){
+  int e, k;
+  DagDescription d = p->dag;
+
+  free(p->edge_table);
+  p->edge_table_size = p->edge_table_size ? 2 * p->edge_table_size : 1024;
+  p->edge_table = (int*) malloc (p->edge_table_size * sizeof(int));
+  memset(p->edge_table, -1, p->edge_table_size * sizeof(int));
+
+  for (e = 0; e < d->nedges; e++){
+    k = dot_hash_edge(d->sources[e], d->destinations[e]) &
+        (p->edge_table_size - 1);
+    while (p->edge_table[k] >= 0)
+      k = (k + 1) & (p->edge_table_size - 1);
+    p->edge_table[k] = e;
+  }
+}
+
+/*
+ * Add an edge, unless it already exists. As SD_PTG_dotload(), only the first
+ * definition of an edge is kept. Return the index of the edge, or -1.
+ */
+static int dot_add_edge(DotParser p, int source, int destination){
+  int e, k;
+  DagDescription d = p->dag;
+
+  k = dot_hash_edge(source, destination) & (p->edge_table_size - 1);
+  while ((e = p->edge_table[k]) >= 0){
+    if (d->sources[e] == source && d->destinations[e] == destination){
+      XBT_WARN("Task '%s->%s' is defined more than once", d->names[source],
+          d->names[destination]);
+      return -1;
+    }
+    k = (k + 1) & (p->edge_table_size - 1);
+  }
+
+  if (d->nedges == p->edges_size){
+    p->edges_size = p->edges_size ? 2 * p->edges_size : 1024;
+    d->sources = (int*) realloc (d->sources, p->edges_size * sizeof(int));
+    d->destinations = (int*) realloc (d->destinations,
+        p->edges_size * sizeof(int));
+    d->sizes = (double*) realloc (d->sizes, p->edges_size * sizeof(double));
+  }
+  d->sources[d->nedges] = source;
+  d->destinations[d->nedges] = destination;
+  d->sizes[d->nedges] = 0.0;
+  p->edge_table[k] = d->nedges++;
+
+  if (2 * d->nedges > p->edge_table_size)
+    dot_grow_edge_table(p);
+
+  return d->nedges - 1;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************                     Parser                      **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/*
+ * Parse an attribute list, the '[' being the current token. The values of the
+ * 'size' and 'alpha' attributes are stored in '*size' and '*alpha' if not
+ * NULL. Other attributes are ignored.
+ */
+static void dot_parse_attributes(DotParser p, double *size, double *alpha){
+  int is_size, is_alpha;
+
+  while (dot_next(p) != DOT_EOF && !dot_is_symbol(p, ']')){
+    if (dot_is_symbol(p, ',') || dot_is_symbol(p, ';'))
+      continue;
+    xbt_assert(p->type == DOT_ID, "%s:%d: attribute name expected", p->file,
+        p->line);
+    is_size = dot_is_keyword(p, "size");
+    is_alpha = dot_is_keyword(p, "alpha");
+
+    dot_next(p);
+    xbt_assert(dot_is_symbol(p, '='), "%s:%d: '=' expected", p->file,
+        p->line);
+    dot_next(p);
+    if (is_size && size)
+      *size = dot_get_number(p);
+    else if (is_alpha && alpha)
+      *alpha = dot_get_number(p);
+  }
+  xbt_assert(p->type != DOT_EOF, "%s:%d: ']' expected", p->file, p->line);
+}
+
+static void dot_parse(DotParser p){
+  int source, destination, edge;
+  double ignored;
+  DagDescription d = p->dag;
+
+  /* Header: [strict] digraph [name] { */
+  dot_next(p);
+  if (dot_is_keyword(p, "strict"))
+    dot_next(p);
+  xbt_assert(dot_is_keyword(p, "digraph"), "%s:%d: 'digraph' expected",
+      p->file, p->line);
+  dot_next(p);
+  if (p->type == DOT_ID)
+    dot_next(p);
+  xbt_assert(dot_is_symbol(p, '{'), "%s:%d: '{' expected", p->file, p->line);
+
+  /* Statements */
+  while (dot_next(p) != DOT_EOF && !dot_is_symbol(p, '}')){
+    if (dot_is_symbol(p, ';'))
+      continue;
+    xbt_assert(p->type == DOT_ID, "%s:%d: node identifier expected", p->file,
+        p->line);
+
+    if (dot_is_keyword(p, "graph") || dot_is_keyword(p, "node") ||
+        dot_is_keyword(p, "edge")){
+      dot_next(p);
+      if (dot_is_symbol(p, '['))
+        dot_parse_attributes(p, NULL, NULL);
+      continue;
+    }
+
+    source = dot_get_node(p);
+    dot_next(p);
+    if (p->type == DOT_ARROW){
+      dot_next(p);
+      xbt_assert(p->type == DOT_ID, "%s:%d: node identifier expected",
+          p->file, p->line);
+      destination = dot_get_node(p);
+      edge = dot_add_edge(p, source, destination);
+      dot_next(p);
+      if (dot_is_symbol(p, '['))
+        dot_parse_attributes(p, (edge >= 0) ? &(d->sizes[edge]) : &ignored,
+            NULL);
+      else
+        p->current = p->start;
+    } else if (dot_is_symbol(p, '[')){
+      dot_parse_attributes(p, &(d->amounts[source]), &(d->alphas[source]));
+    } else {
+      /* Not part of this statement, read it again */
+      p->current = p->start;
+    }
+  }
+  xbt_assert(p->type != DOT_EOF, "%s:%d: '}' expected", p->file, p->line);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************                   DAG creation                  **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/*
+ * Create the SimDag tasks and dependencies of a DAG description, in the same
+ * order as SD_PTG_dotload(): 'root', compute tasks, transfer tasks, and 'end'.
+ * A transfer task is created for each edge that has a positive size, other
+ * edges are control dependencies. Tasks without predecessor are linked to 'root',
+ * tasks without successor to 'end'. The list of edges between compute tasks
+ * is built along the way, in the order dependencies are added, and used to
+ * build the compact view of the DAG.
+ */
+xbt_dynar_t dag_description_load(DagDescription d, Graph *g){
+  int i, e, n = 0;
+  int nedges = d->nedges + 2 * d->nnodes;
+  int *sources, *destinations, *nparents, *nchildren;
+  double *sizes;
+  char *name;
+  SD_task_t root, end, *tasks, *transfers;
+  xbt_dynar_t dag = xbt_dynar_new(sizeof(SD_task_t), NULL);
+
+  tasks = (SD_task_t*) calloc (d->nnodes, sizeof(SD_task_t));
+  sources = (int*) calloc (nedges, sizeof(int));
+  destinations = (int*) calloc (nedges, sizeof(int));
+  sizes = (double*) calloc (nedges, sizeof(double));
+  transfers = (SD_task_t*) calloc (nedges, sizeof(SD_task_t));
+  nparents = (int*) calloc (d->nnodes, sizeof(int));
+  nchildren = (int*) calloc (d->nnodes, sizeof(int));
+
+  root = SD_task_create_comp_par_amdahl("root", NULL, 0, 0);
+  xbt_dynar_push(dag, &root);
+  for (i = 0; i < d->nnodes; i++){
+    tasks[i] = SD_task_create_comp_par_amdahl(d->names[i], NULL,
+        d->amounts[i], d->alphas[i]);
+    xbt_dynar_push(dag, &(tasks[i]));
+  }
+
+  /* Compute tasks are numbered from 1, 'root' being 0 */
+  for (e = 0; e < d->nedges; e++){
+    sources[n] = d->sources[e] + 1;
+    destinations[n] = d->destinations[e] + 1;
+    nchildren[d->sources[e]]++;
+    nparents[d->destinations[e]]++;
+    if (d->sizes[e] > 0){
+      name = bprintf("%s->%s", d->names[d->sources[e]],
+          d->names[d->destinations[e]]);
+      transfers[n] = SD_task_create_comm_par_mxn_1d_block(name, NULL,
+          d->sizes[e]);
+      free(name);
+      sizes[n] = d->sizes[e];
+      SD_task_dependency_add(NULL, NULL, tasks[d->sources[e]], transfers[n]);
+      SD_task_dependency_add(NULL, NULL, transfers[n],
+          tasks[d->destinations[e]]);
+      xbt_dynar_push(dag, &(transfers[n]));
+    } else {
+      SD_task_dependency_add(NULL, NULL, tasks[d->sources[e]],
+          tasks[d->destinations[e]]);
+    }
+    n++;
+  }
+
+  end = SD_task_create_comp_par_amdahl("end", NULL, 0, 0);
+  xbt_dynar_push(dag, &end);
+
+  for (i = 0; i < d->nnodes; i++){
+    if (!nparents[i]){
+      SD_task_dependency_add(NULL, NULL, root, tasks[i]);
+      sources[n] = 0;
+      destinations[n++] = i + 1;
+    }
+    if (!nchildren[i]){
+      SD_task_dependency_add(NULL, NULL, tasks[i], end);
+      sources[n] = i + 1;
+      destinations[n++] = d->nnodes + 1;
+    }
+  }
+
+  *g = graph_new_from_edges(dag, n, sources, destinations, sizes, transfers);
+
+  free(tasks);
+  free(sources);
+  free(destinations);
+  free(sizes);
+  free(transfers);
+  free(nparents);
+  free(nchildren);
+  return dag;
+}
+
+void dag_description_free(DagDescription d){
+  int i;
+
+  for (i = 0; i < d->nnodes; i++)
+    free(d->names[i]);
+  free(d->names);
+  free(d->amounts);
+  free(d->alphas);
+  free(d->sources);
+  free(d->destinations);
+  free(d->sizes);
+  memset(d, 0, sizeof(struct _DagDescription));
+}
+
+/*
+ * Map a file in memory, read-only. '*content' is NULL for an empty file.
+ * Return 0 if the file cannot be opened or mapped.
+ */
+int map_file(const char *file, char **content, size_t *size){
+  int fd;
+  struct stat info;
+
+  *content = NULL;
+  *size = 0;
+  fd = open(file, O_RDONLY);
+  if (fd < 0)
+    return 0;
+  if (fstat(fd, &info)){
+    close(fd);
+    return 0;
+  }
+  *size = info.st_size;
+  if (*size > 0)
+    *content = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (*content == MAP_FAILED){
+    *content = NULL;
+    return 0;
+  }
+  if (*content)
+    madvise(*content, *size, MADV_SEQUENTIAL);
+  return 1;
+}
+
+void unmap_file(char *content, size_t size){
+  if (content)
+    munmap(content, size);
+}
+
+/*
+ * Variant of the 64-bit FNV-1a hash function that processes 8 bytes at a time,
+ * with an extra shift to mix the high bits of the words into the low bits.
+ */
+uint64_t hash_content(const char *content, size_t size){
+  size_t i;
+  uint64_t word, hash = 14695981039346656037ULL;
+
+  for (i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)){
+    memcpy(&word, content + i, sizeof(uint64_t));
+    hash = (hash ^ word) * 1099511628211ULL;
+    hash ^= hash >> 32;
+  }
+  for (; i < size; i++)
+    hash = (hash ^ (unsigned char) content[i]) * 1099511628211ULL;
+  return hash;
+}
+
+/* Hash the content of a file. Return 0 if the file cannot be read. */
+int hash_file(const char *file, uint64_t *hash){
+  size_t size;
+  char *content;
+
+  if (!map_file(file, &content, &size))
+    return 0;
+  *hash = hash_content(content, size);
+  unmap_file(content, size);
+  return 1;
+}
+
+/*
+ * Parse the content of a file in the daggen subset of the DOT format, and fill
+ * the (empty) description 'd'. Return the parse time.
+ */
+double dot_parse_content(const char *file, const char *content, size_t size,
+    DagDescription d){
+  double parse_time;
+  struct _DotParser parser;
+
+  memset(&parser, 0, sizeof(struct _DotParser));
+  parser.file = file;
+  parser.current = content;
+  parser.end = content + size;
+  parser.line = 1;
+  parser.dag = d;
+  dot_grow_node_table(&parser);
+  dot_grow_edge_table(&parser);
+
+  parse_time = get_time();
+  dot_parse(&parser);
+  parse_time = get_time() - parse_time;
+
+  free(parser.table);
+  free(parser.edge_table);
+  return parse_time;
+}
+
+/*
+ * Load a DAG in the daggen subset of the DOT format, and build its compact
+ * view in '*g'. The parse throughput is reported.
+ */
+xbt_dynar_t fast_dotload(const char *file, Graph *g){
+  double parse_time, load_time;
+  size_t size;
+  char *content;
+  struct _DagDescription description;
+  xbt_dynar_t dag;
+
+  load_time = get_time();
+  xbt_assert(map_file(file, &content, &size), "Cannot read DAG file '%s'",
+      file);
+  memset(&description, 0, sizeof(struct _DagDescription));
+  parse_time = dot_parse_content(file, content, size, &description);
+  unmap_file(content, size);
+
+  dag = dag_description_load(&description, g);
+  load_time = get_time() - load_time;
+
+  XBT_VERB("'%s': %.1f MB parsed in %.3f seconds (%.1f MB/s), %d tasks and "
+      "%d edges loaded in %.3f seconds", file, size / 1e6, parse_time,
+      parse_time > 0 ? size / 1e6 / parse_time : 0.0, description.nnodes,
+      description.nedges, load_time);
+
+  dag_description_free(&description);
+  return dag;
+}
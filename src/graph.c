@@ -0,0 +1,296 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#include <stdlib.h>
+#include "simdag/simdag.h"
+#include "xbt.h"
+#include "dag.h"
+#include "graph.h"
+#include "task.h"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(graph, biCPA, "Logging specific to graph");
+
+/*
+ * Fill one direction of the compressed sparse row representation of the edges
+ * between compute tasks, using either SD_task_get_children() or
+ * SD_task_get_parents() as 'get_neighbors'. When the neighbor is a transfer
+ * task, the compute task on the other side of the transfer is stored, along
+ * with the transfer task and its amount of data. Neighbors are kept in the
+ * order given by SimDag. Two passes are made: the first one counts the
+ * neighbors of each task, the second one fills the arrays.
+ */
+static void graph_fill_edges(Graph g, xbt_dynar_t (*get_neighbors)(SD_task_t),
+    int **index, int **neighbors, double **sizes, SD_task_t **transfers){
+  unsigned int j;
+  int i, k;
+  SD_task_t neighbor, other_side;
+  xbt_dynar_t task_neighbors, transfer_neighbors;
+
+  *index = (int*) calloc (g->ncompute + 1, sizeof(int));
+  for (i = 0; i < g->ncompute; i++){
+    task_neighbors = get_neighbors(g->tasks[i]);
+    (*index)[i+1] = (*index)[i] + xbt_dynar_length(task_neighbors);
+    xbt_dynar_free_container(&task_neighbors);
+  }
+
+  *neighbors = (int*) calloc ((*index)[g->ncompute], sizeof(int));
+  *sizes = (double*) calloc ((*index)[g->ncompute], sizeof(double));
+  *transfers = (SD_task_t*) calloc ((*index)[g->ncompute], sizeof(SD_task_t));
+
+  for (i = 0; i < g->ncompute; i++){
+    k = (*index)[i];
+    task_neighbors = get_neighbors(g->tasks[i]);
+    xbt_dynar_foreach(task_neighbors, j, neighbor){
+      if (SD_task_get_kind(neighbor) == SD_TASK_COMM_PAR_MXN_1D_BLOCK) {
+        transfer_neighbors = get_neighbors(neighbor);
+        xbt_dynar_get_cpy(transfer_neighbors, 0, &other_side);
+        xbt_dynar_free_container(&transfer_neighbors);
+        (*sizes)[k] = SD_task_get_amount(neighbor);
+        (*transfers)[k] = neighbor;
+      } else {
+        other_side = neighbor;
+      }
+      (*neighbors)[k++] = SD_task_get_id(other_side);
+    }
+    xbt_dynar_free_container(&task_neighbors);
+  }
+}
+
+/*
+ * Precompute the coefficients of Amdahl's law for each compute task once and
+ * for all. As the workstations are assumed to be homogeneous, the power of the
+ * first one is used. Tasks that are not of kind SD_TASK_COMP_PAR_AMDAHL have
+ * no such coefficients, and are given a null sequential time.
+ */
+static void graph_fill_amdahl_coefficients(Graph g){
+  int i;
+  double power = SD_workstation_get_power(SD_workstation_get_list()[0]);
+
+  g->alpha = (double*) calloc (g->ncompute, sizeof(double));
+  g->parallel_fraction = (double*) calloc (g->ncompute, sizeof(double));
+  g->sequential_time = (double*) calloc (g->ncompute, sizeof(double));
+
+  for (i = 0; i < g->ncompute; i++){
+    if (SD_task_get_kind(g->tasks[i]) != SD_TASK_COMP_PAR_AMDAHL)
+      continue;
+    g->alpha[i] = SD_task_get_alpha(g->tasks[i]);
+    g->parallel_fraction[i] = 1 - g->alpha[i];
+    g->sequential_time[i] = SD_task_get_amount(g->tasks[i]) / power;
+  }
+}
+
+/*
+ * Rank the compute tasks in a topological order, with Kahn's algorithm. Tasks
+ * are ranked as soon as all their parents have been. 'root' is ranked first.
+ */
+static void graph_fill_ranks(Graph g){
+  int i, task, child, first = 0, last = 0;
+  int *queue = (int*) calloc (g->ncompute, sizeof(int));
+  int *npending = g->scratch;
+
+  g->rank = (int*) calloc (g->ncompute, sizeof(int));
+  for (i = 0; i < g->ncompute; i++){
+    npending[i] = g->parent_index[i+1] - g->parent_index[i];
+    if (!npending[i])
+      queue[last++] = i;
+  }
+
+  while (first < last){
+    task = queue[first];
+    g->rank[task] = first++;
+    for (i = g->child_index[task]; i < g->child_index[task+1]; i++){
+      child = g->children[i];
+      if (!--npending[child])
+        queue[last++] = child;
+    }
+  }
+  free(queue);
+}
+
+/*
+ * Fill one direction of the compressed sparse row representation of the edges
+ * from a list of 'nedges' edges, given by their endpoints 'from' and 'to', the
+ * amount of data and the transfer task of each edge. Edges are grouped by
+ * 'from' endpoint with a counting sort that keeps their order in the list.
+ */
+static void graph_fill_edges_from_list(Graph g, int nedges, const int *from,
+    const int *to, const double *edge_sizes, SD_task_t *edge_transfers,
+    int **index, int **neighbors, double **sizes, SD_task_t **transfers){
+  int e, k;
+  int *next = g->scratch;
+
+  *index = (int*) calloc (g->ncompute + 1, sizeof(int));
+  for (e = 0; e < nedges; e++)
+    (*index)[from[e]+1]++;
+  for (k = 0; k < g->ncompute; k++){
+    (*index)[k+1] += (*index)[k];
+    next[k] = (*index)[k];
+  }
+
+  *neighbors = (int*) calloc (nedges, sizeof(int));
+  *sizes = (double*) calloc (nedges, sizeof(double));
+  *transfers = (SD_task_t*) calloc (nedges, sizeof(SD_task_t));
+
+  for (e = 0; e < nedges; e++){
+    k = next[from[e]]++;
+    (*neighbors)[k] = to[e];
+    (*sizes)[k] = edge_transfers[e] ? edge_sizes[e] : 0.0;
+    (*transfers)[k] = edge_transfers[e];
+  }
+}
+
+/*
+ * Number the tasks of a DAG and attach their attributes. The attributes of all
+ * the tasks are allocated in a single array, hence this function replaces
+ * individual calls to SD_task_allocate_attribute().
+ */
+static Graph graph_alloc(xbt_dynar_t dag){
+  unsigned int cursor;
+  int i, id = 0;
+  SD_task_t task;
+  Graph g = (Graph) calloc (1, sizeof(struct _Graph));
+
+  g->ntasks = xbt_dynar_length(dag);
+  g->tasks = (SD_task_t*) calloc (g->ntasks, sizeof(SD_task_t));
+  g->attributes = (struct _TaskAttribute*) calloc (g->ntasks,
+      sizeof(struct _TaskAttribute));
+
+  /* Number compute tasks first, then transfer tasks */
+  xbt_dynar_foreach(dag, cursor, task)
+    if (SD_task_get_kind(task) != SD_TASK_COMM_PAR_MXN_1D_BLOCK)
+      g->tasks[id++] = task;
+  g->ncompute = id;
+  xbt_dynar_foreach(dag, cursor, task)
+    if (SD_task_get_kind(task) == SD_TASK_COMM_PAR_MXN_1D_BLOCK)
+      g->tasks[id++] = task;
+
+  for (i = 0; i < g->ntasks; i++)
+    SD_task_allocate_attribute(g->tasks[i], &(g->attributes[i]), i);
+
+  g->root = SD_task_get_id(get_dag_root(dag));
+  g->end = SD_task_get_id(get_dag_end(dag));
+
+  g->scratch = (int*) calloc (g->ncompute, sizeof(int));
+  g->estimates = (double*) calloc (g->ncompute, sizeof(double));
+
+  return g;
+}
+
+/* Complete the compact view of a DAG once its edges are known */
+static void graph_finalize(Graph g){
+  graph_fill_amdahl_coefficients(g);
+  graph_fill_ranks(g);
+
+  g->updated = (int*) calloc (g->ncompute, sizeof(int));
+  g->update_stamps = (int*) calloc (g->ncompute, sizeof(int));
+
+  XBT_VERB("Graph built: %d compute tasks, %d transfer tasks, %d edges",
+      g->ncompute, g->ntasks - g->ncompute, g->child_index[g->ncompute]);
+}
+
+/*
+ * Build the compact view of a DAG freshly loaded by SD_PTG_dotload(). Edges
+ * are retrieved from SimDag.
+ */
+Graph graph_new(xbt_dynar_t dag){
+  Graph g = graph_alloc(dag);
+
+  graph_fill_edges(g, SD_task_get_children, &(g->child_index), &(g->children),
+      &(g->child_sizes), &(g->child_transfers));
+  graph_fill_edges(g, SD_task_get_parents, &(g->parent_index), &(g->parents),
+      &(g->parent_sizes), &(g->parent_transfers));
+
+  graph_finalize(g);
+  return g;
+}
+
+/*
+ * Build the compact view of a DAG from the list of its edges between compute
+ * tasks, as known by the loader that created the DAG. The identifiers of the
+ * endpoints of the edges are those given by the order of the compute tasks in
+ * 'dag'. Edges without transfer task are control dependencies. The order of the
+ * neighbors of a task is that of the list, which has thus to follow the order
+ * in which the dependencies were added to SimDag.
+ */
+Graph graph_new_from_edges(xbt_dynar_t dag, int nedges, const int *sources,
+    const int *destinations, const double *sizes, SD_task_t *transfers){
+  Graph g = graph_alloc(dag);
+
+  graph_fill_edges_from_list(g, nedges, sources, destinations, sizes,
+      transfers, &(g->child_index), &(g->children), &(g->child_sizes),
+      &(g->child_transfers));
+  graph_fill_edges_from_list(g, nedges, destinations, sources, sizes,
+      transfers, &(g->parent_index), &(g->parents), &(g->parent_sizes),
+      &(g->parent_transfers));
+
+  graph_finalize(g);
+  return g;
+}
+
+void graph_free(Graph g){
+  int i;
+
+  for (i = 0; i < g->ntasks; i++)
+    SD_task_free_attribute(g->tasks[i]);
+
+  free(g->child_index);
+  free(g->children);
+  free(g->child_sizes);
+  free(g->child_transfers);
+  free(g->parent_index);
+  free(g->parents);
+  free(g->parent_sizes);
+  free(g->parent_transfers);
+  free(g->alpha);
+  free(g->parallel_fraction);
+  free(g->sequential_time);
+  free(g->rank);
+  free(g->updated);
+  free(g->update_stamps);
+  free(g->scratch);
+  free(g->estimates);
+  free(g->initial_bottom_levels);
+  free(g->resource_edges);
+  free(g->attributes);
+  free(g->tasks);
+  free(g);
+}
+
+/*
+ * Save the bottom levels of the compute tasks, once set for the initial
+ * allocations (a single workstation per task).
+ */
+void graph_save_initial_state(Graph g){
+  int i;
+
+  if (!g->initial_bottom_levels)
+    g->initial_bottom_levels = (double*) calloc (g->ncompute, sizeof(double));
+  for (i = 0; i < g->ncompute; i++)
+    g->initial_bottom_levels[i] = g->attributes[i].bottom_level;
+}
+
+/* Allocate each compute task on a single workstation, with its saved level */
+void graph_restore_initial_state(Graph g){
+  int i;
+
+  for (i = 0; i < g->ncompute; i++){
+    g->attributes[i].allocation_size = 1;
+    g->attributes[i].bottom_level = g->initial_bottom_levels[i];
+  }
+}
+
+void graph_add_resource_edge(Graph g, int parent, int child){
+  if (g->nresource_edges == g->resource_edges_size){
+    g->resource_edges_size = g->resource_edges_size ?
+        2 * g->resource_edges_size : 64;
+    g->resource_edges = (int*) realloc (g->resource_edges,
+        2 * g->resource_edges_size * sizeof(int));
+  }
+  g->resource_edges[2 * g->nresource_edges] = parent;
+  g->resource_edges[2 * g->nresource_edges + 1] = child;
+  g->nresource_edges++;
+}
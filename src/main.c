@@ -15,24 +15,100 @@
 #include "simdag/simdag.h"
 #include "xbt.h"
 
+#include "batch.h"
 #include "bicpa.h"
 #include "dag.h"
+#include "dagcache.h"
+#include "dot.h"
+#include "graph.h"
+#include "resultcache.h"
+#include "server.h"
+#include "simulator.h"
 #include "task.h"
 #include "workstation.h"
 
 XBT_LOG_NEW_DEFAULT_CATEGORY(biCPA, "Logging specific to biCPA");
 
 char *platform_file = NULL, *dagfile = NULL;
+/* Manifest of (platform, DAG) pairs to schedule in batch mode. Set it with the
+ * --batch flag.
+ */
+char *batch_file = NULL;
+/* Number of workers that schedule the DAGs of a batch concurrently. Set it
+ * with the --jobs flag.
+ */
+int batch_nworkers = 1;
+/* DAG files are loaded with SD_PTG_dotload(), unless the dedicated parser of
+ * the daggen subset of DOT is selected with the --fast-dot flag.
+ */
+int fast_dot_parser = 0;
+/* DAG files are loaded through their binary form, written next to them and
+ * updated when needed, with the --dag-cache flag. The binary form can also be
+ * written beforehand with the 'convert' command.
+ */
+int dag_cache = 0;
+/* Directory where the results are stored, so that scheduling again the same
+ * DAG on the same platform with the same options only displays them. Set it
+ * with the --cache-dir flag. Its size is bounded by --cache-size (in MB).
+ */
+char *cache_dir = NULL;
+double cache_size = 64.;
+/* Unix domain socket on which scheduling requests are served. Set it with the
+ * --server flag.
+ */
+char *server_socket = NULL;
 /* By default, there are no explicit communications between tasks. To have
  * actual data transfers on the network, use the --with-communications flag
  */
 int with_communications = 0;
+/* Number of workers used to evaluate the candidate schedules. Set it with the
+ * --threads flag.
+ */
+int nthreads = 1;
+/* Simulation engine used to evaluate the schedules. By default, SimGrid is
+ * used. Without communications, the native simulator can be selected with the
+ * --simulator=native flag. The --cross-validate flag runs both engines and
+ * checks that their makespans agree within a given relative tolerance. With the
+ * --estimate-only flag, nothing is simulated and the makespans estimated while
+ * building the schedules are used.
+ */
+int simulator = SIMGRID_SIMULATOR;
+double cross_validation_tolerance = -1.;
+/* By default, the schedules of all the assumed sizes of the target cluster are
+ * simulated. With the --screening flag, they are all estimated first, and only
+ * those within a given relative distance of the front of the estimates are
+ * simulated. The --verify-screening flag also simulates all of them to check
+ * that screening does not change the selected variants.
+ */
+double screening_distance = -1.;
+int verify_screening_results = 0;
+/* By default, all the assumed sizes of the target cluster are considered. With
+ * the --sampling flag, a geometric set of sizes is evaluated first, and only the
+ * intervals where the makespan or work changes by more than a given relative
+ * threshold, or where the front of non-dominated schedules changes, are refined.
+ */
+double sampling_threshold = -1.;
+/* By default, a task is mapped after the last task of each of its
+ * workstations. With the --backfilling flag, it may be inserted in the idle
+ * gaps left earlier on the workstations.
+ */
+int backfilling = 0;
+/* With the --utilization flag, the busy workstations of each schedule are
+ * accounted over time, to display its concurrent peak, idle area and
+ * utilization profile, and to compute its work with communications.
+ */
+int utilization_profile = 0;
+/* By default, the allocation procedure of CPA ignores data transfers. With the
+ * --mcpa flag, as in M-CPA, the bottom levels used to allocate the tasks
+ * include the estimated time to redistribute data between the allocations of
+ * parents and children.
+ */
+int mcpa_allocation = 0;
+/* Compact view of the DAG, built once after its loading */
+Graph graph = NULL;
 
 int main(int argc, char **argv) {
-  int flag, total_nworkstations = 0;
-  unsigned int cursor;
-  const SD_workstation_t *workstations = NULL;
-  SD_task_t task;
+  int flag;
   xbt_dynar_t dag;
 
   SD_init(&argc, argv);
@@ -42,11 +118,46 @@ int main(int argc, char **argv) {
   xbt_log_control_set("surf_workstation.thresh:critical");
   xbt_log_control_set("root.fmt:[%9.3r]%e[%13c/%7p]%e%m%n");
 
+  /* biCPA convert <DOT file> [<binary file>] */
+  if (argc > 1 && !strcmp(argv[1], "convert")){
+    xbt_assert(argc == 3 || argc == 4,
+        "Usage: %s convert <DOT file> [<binary file>]", argv[0]);
+    flag = convert_dag(argv[2], (argc == 4) ? argv[3] : NULL);
+    SD_exit();
+    return flag ? 0 : 1;
+  }
+
+  /* biCPA request <socket> "<request line>", to query a running server */
+  if (argc > 1 && !strcmp(argv[1], "request")){
+    xbt_assert(argc == 4, "Usage: %s request <socket> \"<request line>\"",
+        argv[0]);
+    flag = send_request(argv[2], argv[3]);
+    SD_exit();
+    return flag ? 0 : 1;
+  }
+
   while (1){
     static struct option long_options[] = {
         {"platform", 1, 0, 'a'},
         {"dag", 1, 0, 'b'},
         {"with-communications", 0, 0, 'c'},
+        {"threads", 1, 0, 'd'},
+        {"simulator", 1, 0, 'e'},
+        {"cross-validate", 1, 0, 'f'},
+        {"batch", 1, 0, 'g'},
+        {"jobs", 1, 0, 'h'},
+        {"fast-dot", 0, 0, 'i'},
+        {"dag-cache", 0, 0, 'j'},
+        {"cache-dir", 1, 0, 'k'},
+        {"cache-size", 1, 0, 'l'},
+        {"server", 1, 0, 'm'},
+        {"estimate-only", 0, 0, 'n'},
+        {"screening", 1, 0, 'o'},
+        {"verify-screening", 0, 0, 'p'},
+        {"sampling", 1, 0, 'q'},
+        {"backfilling", 0, 0, 's'},
+        {"utilization", 0, 0, 't'},
+        {"mcpa", 0, 0, 'u'},
         {0, 0, 0, 0}
     };
 
@@ -70,54 +181,144 @@ int main(int argc, char **argv) {
       break;
     case 'a':
       platform_file = optarg;
-      SD_create_environment(platform_file);
-      total_nworkstations = SD_workstation_get_number();
-      workstations = SD_workstation_get_list();
-
-      /* Sort the hosts by name for sake of simplicity */
-      qsort((void *)workstations,total_nworkstations, sizeof(SD_workstation_t),
-          nameCompareWorkstations);
-
-      for(cursor=0; cursor<total_nworkstations; cursor++){
-        SD_workstation_allocate_attribute(workstations[cursor]);
-      }
       break;
     case 'b':
       dagfile = optarg;
-      dag = SD_PTG_dotload(dagfile);
-      xbt_dynar_foreach(dag, cursor, task) {
-        SD_task_allocate_attribute(task);
-      }
-
-      set_bottom_levels (dag);
-
-      if (XBT_LOG_ISENABLED(biCPA, xbt_log_priority_verbose)){
-        xbt_dynar_foreach(dag, cursor, task) {
-          if (SD_task_get_kind(task) != SD_TASK_COMM_PAR_MXN_1D_BLOCK)
-            XBT_VERB("%s: bl=%f",
-                SD_task_get_name(task), SD_task_get_bottom_level(task));
-        }
-      }
       break;
     case 'c':
       with_communications = 1;
       break;
+    case 'd':
+      nthreads = atoi(optarg);
+      if (nthreads < 1)
+        nthreads = 1;
+      break;
+    case 'e':
+      if (!strcmp(optarg, "native"))
+        simulator = NATIVE_SIMULATOR;
+      else if (!strcmp(optarg, "simgrid"))
+        simulator = SIMGRID_SIMULATOR;
+      else if (!strcmp(optarg, "estimate"))
+        simulator = ESTIMATE_ONLY;
+      else
+        XBT_WARN("Unknown simulator '%s'. Use SimGrid", optarg);
+      break;
+    case 'f':
+      cross_validation_tolerance = atof(optarg);
+      break;
+    case 'g':
+      batch_file = optarg;
+      break;
+    case 'h':
+      batch_nworkers = atoi(optarg);
+      if (batch_nworkers < 1)
+        batch_nworkers = 1;
+      break;
+    case 'i':
+      fast_dot_parser = 1;
+      break;
+    case 'j':
+      dag_cache = 1;
+      break;
+    case 'k':
+      cache_dir = optarg;
+      break;
+    case 'l':
+      cache_size = atof(optarg);
+      break;
+    case 'm':
+      server_socket = optarg;
+      break;
+    case 'n':
+      simulator = ESTIMATE_ONLY;
+      break;
+    case 'o':
+      screening_distance = atof(optarg);
+      if (screening_distance < 0.)
+        screening_distance = 0.;
+      break;
+    case 'p':
+      verify_screening_results = 1;
+      break;
+    case 'q':
+      sampling_threshold = atof(optarg);
+      if (sampling_threshold < 0.)
+        sampling_threshold = 0.;
+      break;
+    case 's':
+      backfilling = 1;
+      break;
+    case 't':
+      utilization_profile = 1;
+      break;
+    case 'u':
+      mcpa_allocation = 1;
+      break;
     default:
       break;
     }
   }
 
-  schedule_with_biCPA(dag);
+  if (with_communications && simulator == NATIVE_SIMULATOR){
+    XBT_WARN("The native simulator is only available without communications."
+        " Use SimGrid");
+    simulator = SIMGRID_SIMULATOR;
+  }
+
+  if (simulator == ESTIMATE_ONLY && cross_validation_tolerance >= 0.){
+    XBT_WARN("Nothing is simulated in estimate-only mode. Ignore "
+        "--cross-validate");
+    cross_validation_tolerance = -1.;
+  }
 
-  xbt_dynar_foreach(dag, cursor, task) {
-    SD_task_free_attribute(task);
-    free(SD_task_get_data(task));
-    SD_task_destroy(task);
+  if (simulator == ESTIMATE_ONLY && screening_distance >= 0.){
+    XBT_WARN("Nothing is simulated in estimate-only mode. Ignore --screening");
+    screening_distance = -1.;
+  }
+
+  if (mcpa_allocation && !with_communications){
+    XBT_WARN("There is no data to redistribute without communications. Ignore "
+        "--mcpa");
+    mcpa_allocation = 0;
+  }
+
+  if (sampling_threshold >= 0. && screening_distance >= 0.){
+    XBT_WARN("Screening needs all the sizes to be estimated. Ignore "
+        "--screening with --sampling");
+    screening_distance = -1.;
+  }
+
+  if (verify_screening_results && screening_distance < 0.){
+    XBT_WARN("--verify-screening needs --screening. Ignore it");
+    verify_screening_results = 0;
+  }
+
+  if (cache_dir && cross_validation_tolerance >= 0.)
+    XBT_WARN("Cached results are displayed without simulating their schedules "
+        "again: --cross-validate only applies to the results not in the "
+        "cache");
+
+  result_cache_init();
+
+  if (server_socket) {
+    run_server(server_socket);
+  } else if (batch_file) {
+    run_batch(batch_file);
+  } else {
+    xbt_assert(platform_file && dagfile,
+        "Both --platform and --dag are needed (or --batch or --server)");
+    if (!result_cache_lookup(platform_file, dagfile)) {
+      load_platform(platform_file);
+      dag = load_dag(dagfile);
+
+      schedule_with_biCPA(dag);
+
+      free_dag(dag);
+      free_platform();
+    }
   }
-  xbt_dynar_free_container(&dag);
 
-  for(cursor = 0; cursor < total_nworkstations; cursor++)
-    SD_workstation_free_attribute(workstations[cursor]);
+  result_cache_report();
 
   SD_exit();
 
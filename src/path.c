@@ -0,0 +1,270 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#include <stdlib.h>
+#include "simdag/simdag.h"
+#include "xbt.h"
+#include "bicpa.h"
+#include "graph.h"
+#include "path.h"
+#include "task.h"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(path, biCPA,
+    "Logging specific to critical path");
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************                  Heap of gains                  **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/* Does task 't1' have to be selected before task 't2'? */
+static int heap_before(CriticalPath path, int t1, int t2){
+  return (path->gains[t1] > path->gains[t2]) ||
+      (path->gains[t1] == path->gains[t2] && graph->rank[t1] < graph->rank[t2]);
+}
+
+static void heap_place(CriticalPath path, int i, int task){
+  path->heap[i] = task;
+  path->heap_position[task] = i;
+}
+
+static void heap_sift_up(CriticalPath path, int i){
+  int task = path->heap[i], parent;
+
+  while (i > 0){
+    parent = (i - 1) / 2;
+    if (!heap_before(path, task, path->heap[parent]))
+      break;
+    heap_place(path, i, path->heap[parent]);
+    i = parent;
+  }
+  heap_place(path, i, task);
+}
+
+static void heap_sift_down(CriticalPath path, int i){
+  int task = path->heap[i], child;
+
+  while ((child = 2 * i + 1) < path->nheap){
+    if (child + 1 < path->nheap &&
+        heap_before(path, path->heap[child+1], path->heap[child]))
+      child++;
+    if (!heap_before(path, path->heap[child], task))
+      break;
+    heap_place(path, i, path->heap[child]);
+    i = child;
+  }
+  heap_place(path, i, task);
+}
+
+static void heap_remove(CriticalPath path, int task){
+  int i = path->heap_position[task], last;
+
+  if (i < 0)
+    return;
+  path->heap_position[task] = -1;
+  last = path->heap[--path->nheap];
+  if (i == path->nheap)
+    return;
+  heap_place(path, i, last);
+  heap_sift_up(path, i);
+  heap_sift_down(path, path->heap_position[last]);
+}
+
+/*
+ * Compute the gain of a task on its current allocation and insert it in the
+ * heap (or move it within the heap) if this gain is positive. If the task is
+ * already allocated on the full cluster, the gain is zero.
+ */
+static void heap_update(CriticalPath path, int task){
+  int n = graph->attributes[task].allocation_size;
+
+  path->gains[task] = 0.0;
+  if (n < path->nworkstations)
+    SD_task_estimate_gains(1, &task, &n, &(path->gains[task]));
+
+  if (path->gains[task] <= 0.0){
+    heap_remove(path, task);
+  } else if (path->heap_position[task] < 0){
+    path->heap_position[task] = path->nheap++;
+    heap_place(path, path->heap_position[task], task);
+    heap_sift_up(path, path->heap_position[task]);
+  } else {
+    heap_sift_up(path, path->heap_position[task]);
+    heap_sift_down(path, path->heap_position[task]);
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************                 Path management                 **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/*
+ * Return the compute child of a task with the biggest bottom level, including
+ * the redistribution time along the edge with the M-CPA allocation. In case of
+ * ties, the first one in the order of the children is returned.
+ */
+static int get_max_bottom_level_child(int task){
+  int i, max_BL_child = -1;
+  double bottom_level, max_bottom_level = 0.0;
+
+  for (i = graph->child_index[task]; i < graph->child_index[task+1]; i++){
+    bottom_level = SD_task_estimate_child_bottom_level(task, i);
+    if (i == graph->child_index[task] || max_bottom_level < bottom_level){
+      max_BL_child = graph->children[i];
+      max_bottom_level = bottom_level;
+    }
+  }
+  return max_BL_child;
+}
+
+static void path_add(CriticalPath path, int previous, int task){
+  path->on_path[task] = 1;
+  path->next[previous] = task;
+  path->previous[task] = previous;
+  path->next[task] = -1;
+  heap_update(path, task);
+}
+
+static void path_remove(CriticalPath path, int task){
+  path->on_path[task] = 0;
+  path->next[task] = path->previous[task] = -1;
+  heap_remove(path, task);
+}
+
+/*
+ * Browse the DAG from 'task', which is on the path, by following the compute
+ * children with the biggest bottom levels until a task of the current path is
+ * found. The tasks of the current path that are skipped are removed from it,
+ * the new ones are added.
+ */
+static void path_follow(CriticalPath path, int task){
+  int current = task, child, skipped, next_skipped;
+  int first_skipped = path->next[task];
+
+  child = get_max_bottom_level_child(task);
+  if (child == first_skipped)
+    return;
+
+  while (!path->on_path[child]){
+    XBT_DEBUG("Task '%s' enters the critical path",
+        SD_task_get_name(graph->tasks[child]));
+    path_add(path, current, child);
+    current = child;
+    child = get_max_bottom_level_child(child);
+  }
+
+  /* 'child' comes after 'task' on the current path, as ranks increase along
+   * paths */
+  for (skipped = first_skipped; skipped != child; skipped = next_skipped){
+    XBT_DEBUG("Task '%s' leaves the critical path",
+        SD_task_get_name(graph->tasks[skipped]));
+    next_skipped = path->next[skipped];
+    path_remove(path, skipped);
+  }
+  path->next[current] = child;
+  path->previous[child] = current;
+}
+
+/*
+ * Build the critical path from the current bottom levels. 'root' is the first
+ * task of the linked list, but is not a candidate for allocation increase.
+ */
+CriticalPath critical_path_new(int nworkstations){
+  int i, task, child;
+  CriticalPath path = (CriticalPath) calloc (1, sizeof(struct _CriticalPath));
+
+  path->nworkstations = nworkstations;
+  path->on_path = (int*) calloc (graph->ncompute, sizeof(int));
+  path->next = (int*) calloc (graph->ncompute, sizeof(int));
+  path->previous = (int*) calloc (graph->ncompute, sizeof(int));
+  path->gains = (double*) calloc (graph->ncompute, sizeof(double));
+  path->heap = (int*) calloc (graph->ncompute, sizeof(int));
+  path->heap_position = (int*) calloc (graph->ncompute, sizeof(int));
+  path->affected = (int*) calloc (graph->ncompute, sizeof(int));
+  path->is_affected = (int*) calloc (graph->ncompute, sizeof(int));
+
+  for (i = 0; i < graph->ncompute; i++)
+    path->next[i] = path->previous[i] = path->heap_position[i] = -1;
+
+  task = graph->root;
+  path->on_path[task] = 1;
+  while (task != graph->end) {
+    child = get_max_bottom_level_child(task);
+    path_add(path, task, child);
+    task = child;
+  }
+
+  return path;
+}
+
+void critical_path_free(CriticalPath path){
+  free(path->on_path);
+  free(path->next);
+  free(path->previous);
+  free(path->gains);
+  free(path->heap);
+  free(path->heap_position);
+  free(path->affected);
+  free(path->is_affected);
+  free(path);
+}
+
+/*
+ * Return the task of the critical path that benefits the most of an extra
+ * workstation, or -1 if no task can have its allocation increased.
+ */
+int critical_path_get_best_task(CriticalPath path){
+  return path->nheap ? path->heap[0] : -1;
+}
+
+static int rankCompareTasks(const void *t1, const void *t2){
+  return graph->rank[*((int*)t1)] - graph->rank[*((int*)t2)];
+}
+
+/*
+ * Update the critical path after the allocation of 'selected_task' has been
+ * increased and the bottom levels have been updated accordingly. Only the tasks
+ * of the path that have a child whose bottom level changed can have a new
+ * successor on the path. They are processed in the path order, and the path is
+ * modified from each of them until it joins the former path again. The result
+ * is the same as browsing the whole DAG from 'root' again. With the M-CPA
+ * allocation, the redistribution times along the edges of the selected task
+ * change with its allocation, so that its own successor may change too.
+ */
+void critical_path_update(CriticalPath path, int selected_task){
+  int i, j, task, parent;
+
+  heap_update(path, selected_task);
+
+  path->naffected = 0;
+  if (mcpa_allocation){
+    path->is_affected[selected_task] = 1;
+    path->affected[path->naffected++] = selected_task;
+  }
+  for (i = 0; i < graph->nupdated; i++){
+    task = graph->updated[i];
+    for (j = graph->parent_index[task]; j < graph->parent_index[task+1]; j++){
+      parent = graph->parents[j];
+      if (path->on_path[parent] && !path->is_affected[parent]){
+        path->is_affected[parent] = 1;
+        path->affected[path->naffected++] = parent;
+      }
+    }
+  }
+
+  qsort(path->affected, path->naffected, sizeof(int), rankCompareTasks);
+
+  for (i = 0; i < path->naffected; i++){
+    task = path->affected[i];
+    path->is_affected[task] = 0;
+    if (path->on_path[task])
+      path_follow(path, task);
+  }
+}
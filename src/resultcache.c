@@ -0,0 +1,449 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "simdag/simdag.h"
+#include "xbt.h"
+#include "bicpa.h"
+#include "dag.h"
+#include "dot.h"
+#include "resultcache.h"
+#include "simulator.h"
+#include "timer.h"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(resultcache, biCPA,
+    "Logging specific to the result cache");
+
+/*
+ * On-disk store of the results of biCPA, one file per (DAG, platform, options)
+ * triple in the cache directory. The DAG and platform files are identified by
+ * hashes of their content, so that renamed or copied files hit the cache while
+ * modified ones miss it. The name of a result file is a hash of this key, and
+ * the key itself is stored in the file to detect collisions. The results are
+ * stored as in a BiCPA_result_t, in the order they are displayed, so that a hit
+ * displays what a run would, except for the timings: the lookup time is
+ * displayed as allocation time, and the mapping time is 0.
+ * The content hash of a file is itself cached per path, with the size and
+ * modification time of the file, so that a lookup does not read the DAG and
+ * platform files unless they changed (see result_cache_hash_file()).
+ * The total size of the result files is bounded. When it is exceeded, the least
+ * recently used files are removed, a hit updating the modification time of the
+ * file it reads.
+ */
+#define RESULT_CACHE_MAGIC   "biCPAres"
+#define RESULT_CACHE_VERSION 7
+#define RESULT_CACHE_SUFFIX  ".res"
+#define RESULT_CACHE_HASH_SUFFIX ".hash"
+
+typedef struct _ResultCacheKey {
+  uint64_t dag_hash;
+  uint64_t platform_hash;
+  uint64_t options;
+  double screening_distance;
+  double sampling_threshold;
+} ResultCacheKey;
+
+typedef struct _ResultCacheHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t nworkstations;
+  int32_t nschedules;
+  ResultCacheKey key;
+  int32_t best_makespan_nworkstations;
+  int32_t best_work_nworkstations;
+  int32_t perfect_equity_nworkstations;
+  int32_t min_sum_nworkstations;
+} ResultCacheHeader;
+
+/*
+ * Content hash of the file at a given path, valid as long as the size and
+ * modification time of the file are those recorded. The date of the record is
+ * kept, as a modification in the same second as the record would go unnoticed.
+ */
+typedef struct _ResultCacheFileHash {
+  char magic[8];
+  uint32_t version;
+  uint64_t size;
+  int64_t mtime;
+  int64_t mtime_nsec;
+  int64_t recorded;
+  uint64_t hash;
+} ResultCacheFileHash;
+
+/*
+ * Counters of the cache, in memory shared with the processes forked in batch
+ * mode, so that the report covers all of them.
+ */
+typedef struct _ResultCacheCounters {
+  long hits;
+  long misses;
+  long stores;
+  long evictions;
+} *ResultCacheCounters;
+
+static ResultCacheCounters counters = NULL;
+
+/* Result file, with its size and last use, considered for eviction */
+typedef struct _ResultCacheEntry {
+  char *file;
+  off_t size;
+  struct timespec last_use;
+} ResultCacheEntry;
+
+/*
+ * Options that may change the results of biCPA. Options that only change the
+ * way the results are computed (number of workers, DAG loader, verification of
+ * the screening) are not part of the key.
+ */
+static uint64_t result_cache_options(void){
+  return (uint64_t) with_communications | ((uint64_t) simulator << 1) |
+      ((uint64_t) backfilling << 4) |
+      ((uint64_t) utilization_profile << 5) | ((uint64_t) mcpa_allocation << 6);
+}
+
+/*
+ * Write 'size' bytes of 'content' in 'file', under a temporary name first, then
+ * renamed, so that concurrent readers never see a partial file. Return 0 on
+ * failure.
+ */
+static int result_cache_write_file(const char *file, const void *content,
+    size_t size){
+  int fd, written;
+  char *temporary_file;
+  FILE *output;
+
+  temporary_file = bprintf("%s.XXXXXX", file);
+  fd = mkstemp(temporary_file);
+  if (fd >= 0)
+    fchmod(fd, 0644);
+  output = (fd >= 0) ? fdopen(fd, "w") : NULL;
+  written = (output != NULL);
+  if (output){
+    written = fwrite(content, size, 1, output) == 1;
+    written = !fclose(output) && written && !rename(temporary_file, file);
+  }
+  if (fd >= 0 && !written)
+    unlink(temporary_file);
+  free(temporary_file);
+  return written;
+}
+
+/*
+ * Get the content hash of 'file'. It is read from the record of the resolved
+ * path of the file in the cache directory when the size and modification time
+ * of the file match the record. Otherwise, the file is hashed and its record
+ * written. Return 0 if the file cannot be read.
+ */
+static int result_cache_hash_file(const char *file, uint64_t *hash){
+  int found = 0;
+  char *path, *record_file;
+  FILE *input;
+  struct stat info;
+  ResultCacheFileHash record;
+
+  if (!(path = realpath(file, NULL)) || stat(path, &info)){
+    free(path);
+    return hash_file(file, hash);
+  }
+  record_file = bprintf("%s/%016llx%s", cache_dir, (unsigned long long)
+      hash_content(path, strlen(path)), RESULT_CACHE_HASH_SUFFIX);
+
+  if ((input = fopen(record_file, "r"))){
+    found = fread(&record, sizeof(ResultCacheFileHash), 1, input) == 1 &&
+        !memcmp(record.magic, RESULT_CACHE_MAGIC, sizeof(record.magic)) &&
+        record.version == RESULT_CACHE_VERSION &&
+        record.size == (uint64_t) info.st_size &&
+        record.mtime == (int64_t) info.st_mtim.tv_sec &&
+        record.mtime_nsec == (int64_t) info.st_mtim.tv_nsec &&
+        record.mtime < record.recorded;
+    fclose(input);
+  }
+
+  if (found){
+    *hash = record.hash;
+  } else if ((found = hash_file(path, hash))){
+    memset(&record, 0, sizeof(ResultCacheFileHash));
+    memcpy(record.magic, RESULT_CACHE_MAGIC, sizeof(record.magic));
+    record.version = RESULT_CACHE_VERSION;
+    record.size = info.st_size;
+    record.mtime = info.st_mtim.tv_sec;
+    record.mtime_nsec = info.st_mtim.tv_nsec;
+    record.recorded = time(NULL);
+    record.hash = *hash;
+    result_cache_write_file(record_file, &record,
+        sizeof(ResultCacheFileHash));
+  }
+
+  free(record_file);
+  free(path);
+  return found;
+}
+
+static int result_cache_get_key(const char *platform_file, const char *dagfile,
+    ResultCacheKey *key){
+  memset(key, 0, sizeof(ResultCacheKey));
+  key->options = result_cache_options();
+  key->screening_distance = screening_distance;
+  key->sampling_threshold = sampling_threshold;
+  return result_cache_hash_file(dagfile, &(key->dag_hash)) &&
+      result_cache_hash_file(platform_file, &(key->platform_hash));
+}
+
+static char *result_cache_get_file(const ResultCacheKey *key){
+  return bprintf("%s/%016llx%s", cache_dir, (unsigned long long)
+      hash_content((const char*) key, sizeof(ResultCacheKey)),
+      RESULT_CACHE_SUFFIX);
+}
+
+/*
+ * Create the cache directory if needed, and the counters. To be called before
+ * any fork.
+ */
+void result_cache_init(void){
+  if (!cache_dir)
+    return;
+  xbt_assert(!mkdir(cache_dir, 0755) || errno == EEXIST,
+      "Cannot create cache directory '%s'", cache_dir);
+  counters = (ResultCacheCounters) mmap(NULL,
+      sizeof(struct _ResultCacheCounters), PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  xbt_assert(counters != MAP_FAILED, "Cannot allocate the cache counters");
+  memset(counters, 0, sizeof(struct _ResultCacheCounters));
+}
+
+/*
+ * Read the results stored in 'file' for 'key'. Return NULL if the file does
+ * not exist, or is not a valid result file for this key.
+ */
+static BiCPA_result_t result_cache_read(const char *file,
+    const ResultCacheKey *key){
+  int i, valid;
+  FILE *input;
+  ResultCacheHeader header;
+  struct _SchedInfo s;
+  BiCPA_result_t r;
+
+  if (!(input = fopen(file, "r")))
+    return NULL;
+
+  valid = fread(&header, sizeof(ResultCacheHeader), 1, input) == 1 &&
+      !memcmp(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic)) &&
+      header.version == RESULT_CACHE_VERSION &&
+      !memcmp(&(header.key), key, sizeof(ResultCacheKey)) &&
+      header.nworkstations > 0 && header.nschedules > 0 &&
+      header.nschedules <= header.nworkstations;
+  if (!valid){
+    fclose(input);
+    return NULL;
+  }
+
+  r = (BiCPA_result_t) calloc (1, sizeof(struct _BiCPAResult));
+  r->nworkstations = header.nworkstations;
+  r->nschedules = header.nschedules;
+  r->best_makespan_nworkstations = header.best_makespan_nworkstations;
+  r->best_work_nworkstations = header.best_work_nworkstations;
+  r->perfect_equity_nworkstations = header.perfect_equity_nworkstations;
+  r->min_sum_nworkstations = header.min_sum_nworkstations;
+  r->siList = (Sched_info_t*) calloc (r->nworkstations, sizeof(Sched_info_t));
+
+  for (i = 0; i < r->nschedules; i++){
+    if (fread(&s, sizeof(struct _SchedInfo), 1, input) != 1)
+      break;
+    r->siList[i] = copy_sched_info(s.nworkstations, &s);
+  }
+  fclose(input);
+
+  if (i < r->nschedules){
+    r->nschedules = i;
+    free_biCPA_result(r);
+    return NULL;
+  }
+  return r;
+}
+
+/*
+ * Return the results of biCPA for 'dagfile' on 'platform_file' if they are in
+ * the cache, NULL on a miss. Their allocation time is the lookup time, and their
+ * mapping time is 0. They have to be freed by the caller.
+ */
+BiCPA_result_t result_cache_fetch(const char *platform_file,
+    const char *dagfile){
+  double lookup_time;
+  char *file;
+  ResultCacheKey key;
+  BiCPA_result_t r;
+
+  if (!cache_dir)
+    return NULL;
+
+  lookup_time = get_time();
+  if (!result_cache_get_key(platform_file, dagfile, &key))
+    return NULL;
+  file = result_cache_get_file(&key);
+  r = result_cache_read(file, &key);
+
+  if (!r){
+    XBT_VERB("Results of '%s' on '%s' are not in the cache", dagfile,
+        platform_file);
+    __sync_fetch_and_add(&(counters->misses), 1);
+    free(file);
+    return NULL;
+  }
+
+  utimes(file, NULL);
+  __sync_fetch_and_add(&(counters->hits), 1);
+  r->alloc_time = get_time() - lookup_time;
+  r->mapping_time = 0.0;
+  XBT_VERB("Results of '%s' on '%s' read from '%s' in %.6f seconds", dagfile,
+      platform_file, file, r->alloc_time);
+
+  free(file);
+  return r;
+}
+
+/*
+ * Display the results of biCPA for 'dagfile' on 'platform_file' if they are in
+ * the cache. Return 0 on a miss.
+ */
+int result_cache_lookup(const char *platform_file, const char *dagfile){
+  BiCPA_result_t r = result_cache_fetch(platform_file, dagfile);
+
+  if (!r)
+    return 0;
+  print_biCPA_result(r);
+  free_biCPA_result(r);
+  return 1;
+}
+
+static int result_cache_compare_entries(const void *e1, const void *e2){
+  const ResultCacheEntry *entry1 = (const ResultCacheEntry*) e1;
+  const ResultCacheEntry *entry2 = (const ResultCacheEntry*) e2;
+
+  if (entry1->last_use.tv_sec != entry2->last_use.tv_sec)
+    return (entry1->last_use.tv_sec < entry2->last_use.tv_sec) ? -1 : 1;
+  if (entry1->last_use.tv_nsec != entry2->last_use.tv_nsec)
+    return (entry1->last_use.tv_nsec < entry2->last_use.tv_nsec) ? -1 : 1;
+  return strcmp(entry1->file, entry2->file);
+}
+
+/*
+ * Remove the least recently used result files until their total size fits in
+ * the bound of the cache.
+ */
+static void result_cache_evict(void){
+  int i, nentries = 0, entries_size = 0;
+  size_t length, suffix_length = strlen(RESULT_CACHE_SUFFIX);
+  double total_size = 0.0;
+  DIR *directory;
+  struct dirent *d;
+  struct stat info;
+  ResultCacheEntry *entries = NULL;
+
+  if (!(directory = opendir(cache_dir)))
+    return;
+
+  while ((d = readdir(directory))){
+    length = strlen(d->d_name);
+    if (length <= suffix_length ||
+        strcmp(d->d_name + length - suffix_length, RESULT_CACHE_SUFFIX))
+      continue;
+    if (nentries == entries_size){
+      entries_size = entries_size ? 2 * entries_size : 64;
+      entries = (ResultCacheEntry*) realloc (entries,
+          entries_size * sizeof(ResultCacheEntry));
+    }
+    entries[nentries].file = bprintf("%s/%s", cache_dir, d->d_name);
+    if (stat(entries[nentries].file, &info)){
+      free(entries[nentries].file);
+      continue;
+    }
+    entries[nentries].size = info.st_size;
+    entries[nentries].last_use = info.st_mtim;
+    total_size += info.st_size;
+    nentries++;
+  }
+  closedir(directory);
+
+  if (total_size > cache_size * 1e6){
+    qsort(entries, nentries, sizeof(ResultCacheEntry),
+        result_cache_compare_entries);
+    for (i = 0; i < nentries && total_size > cache_size * 1e6; i++)
+      if (!unlink(entries[i].file)){
+        XBT_VERB("Evict '%s' from the cache", entries[i].file);
+        total_size -= entries[i].size;
+        __sync_fetch_and_add(&(counters->evictions), 1);
+      }
+  }
+
+  for (i = 0; i < nentries; i++)
+    free(entries[i].file);
+  free(entries);
+}
+
+/*
+ * Store the results of biCPA for 'dagfile' on 'platform_file' in the cache, if
+ * any. The file is written under a temporary name first, then renamed, so that
+ * concurrent lookups never read a partial file.
+ */
+void result_cache_store(const char *platform_file, const char *dagfile,
+    BiCPA_result_t r){
+  int i;
+  size_t size;
+  char *file, *content;
+  ResultCacheHeader header;
+
+  if (!cache_dir)
+    return;
+
+  memset(&header, 0, sizeof(ResultCacheHeader));
+  if (!result_cache_get_key(platform_file, dagfile, &(header.key)))
+    return;
+  memcpy(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic));
+  header.version = RESULT_CACHE_VERSION;
+  header.nworkstations = r->nworkstations;
+  header.nschedules = r->nschedules;
+  header.best_makespan_nworkstations = r->best_makespan_nworkstations;
+  header.best_work_nworkstations = r->best_work_nworkstations;
+  header.perfect_equity_nworkstations = r->perfect_equity_nworkstations;
+  header.min_sum_nworkstations = r->min_sum_nworkstations;
+
+  size = sizeof(ResultCacheHeader) + r->nschedules * sizeof(struct _SchedInfo);
+  content = (char*) malloc (size);
+  memcpy(content, &header, sizeof(ResultCacheHeader));
+  for (i = 0; i < r->nschedules; i++)
+    memcpy(content + sizeof(ResultCacheHeader) + i * sizeof(struct _SchedInfo),
+        r->siList[i], sizeof(struct _SchedInfo));
+
+  file = result_cache_get_file(&(header.key));
+  if (result_cache_write_file(file, content, size)){
+    __sync_fetch_and_add(&(counters->stores), 1);
+    result_cache_evict();
+  } else {
+    XBT_WARN("Cannot store results in '%s'", file);
+  }
+
+  free(content);
+  free(file);
+}
+
+void result_cache_report(void){
+  if (!cache_dir)
+    return;
+  XBT_INFO("Result cache '%s': %ld hits, %ld misses, %ld stored, %ld evicted",
+      cache_dir, counters->hits, counters->misses, counters->stores,
+      counters->evictions);
+}
@@ -0,0 +1,600 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "simdag/simdag.h"
+#include "xbt.h"
+
+#include "bicpa.h"
+#include "dag.h"
+#include "graph.h"
+#include "resultcache.h"
+#include "server.h"
+#include "task.h"
+#include "timer.h"
+#include "workstation.h"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(server, biCPA, "Logging specific to server");
+
+/*
+ * Scheduling server. Clients connect to a Unix domain socket and send one
+ * request per connection, as a line of text:
+ *   - "SCHEDULE <platform file> <DAG file>": schedule the DAG with biCPA. The
+ *     reply is the usual output, followed by the allocations of the compute
+ *     tasks for the four variants and CPA, one "ALLOC:<variant>:<task>:<size>"
+ *     line per task and variant;
+ *   - "STATS": numbers of scheduling requests served and failed, and
+ *     percentiles of the latency of the served ones (in seconds, from the
+ *     connection to the end of the reply);
+ *   - "SHUTDOWN": stop the server.
+ * Each reply ends with an "END" line. Errors are reported as "ERROR <message>"
+ * lines. Relative paths are relative to the directory of the server.
+ *
+ * As SimGrid runs a single simulation engine per process, each platform is
+ * loaded once in a process forked by the server. This process receives the
+ * requests for its platform, together with the descriptor of the client
+ * connection, and forks a handler per request. Handlers thus start with the
+ * simulator initialized and the platform loaded, and requests are processed
+ * concurrently. The statistics are kept in memory shared by all processes.
+ */
+
+/* Number of latencies kept to compute the percentiles (the last ones) */
+#define SERVER_NLATENCIES 4096
+
+/* Numbers of requests served and failed, and latencies of the served ones */
+typedef struct _ServerStats {
+  long nrequests;
+  long nfailures;
+  double latencies[SERVER_NLATENCIES];
+} *ServerStats;
+
+/* Request forwarded to the process of a platform, with the client descriptor */
+typedef struct _ServerRequest {
+  double accept_time;
+  char dagfile[PATH_MAX];
+} ServerRequest;
+
+/* Process in which a platform is loaded, and socket to send it requests */
+typedef struct _PlatformServer {
+  char *platform_file;
+  pid_t pid;
+  int channel;
+} PlatformServer;
+
+/* Number of seconds a client has to send its request line */
+#define SERVER_REQUEST_TIMEOUT 5.0
+
+/* Connected client, whose request line is being read */
+typedef struct _PendingClient {
+  int fd;
+  int length;
+  double accept_time;
+  char line[2 * PATH_MAX + 32];
+} PendingClient;
+
+static ServerStats stats = NULL;
+static volatile sig_atomic_t server_stopped = 0;
+
+static void server_stop(int signal_number){
+  server_stopped = 1;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************         Transfer of requests and clients        **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/* Send a request and the descriptor of its client. Return 0 on failure. */
+static int server_send_request(int channel, ServerRequest *request,
+    int client){
+  char control[CMSG_SPACE(sizeof(int))];
+  struct iovec data = { request, sizeof(ServerRequest) };
+  struct msghdr message;
+  struct cmsghdr *header;
+
+  memset(&message, 0, sizeof(struct msghdr));
+  memset(control, 0, sizeof(control));
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  header = CMSG_FIRSTHDR(&message);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(header), &client, sizeof(int));
+
+  return sendmsg(channel, &message, MSG_NOSIGNAL) == sizeof(ServerRequest);
+}
+
+/*
+ * Receive a request and the descriptor of its client. Return 0 when the server
+ * closed the channel.
+ */
+static int server_receive_request(int channel, ServerRequest *request,
+    int *client){
+  ssize_t received;
+  char control[CMSG_SPACE(sizeof(int))];
+  struct iovec data = { request, sizeof(ServerRequest) };
+  struct msghdr message;
+  struct cmsghdr *header;
+
+  do {
+    memset(&message, 0, sizeof(struct msghdr));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    received = recvmsg(channel, &message, 0);
+  } while (received < 0 && errno == EINTR);
+
+  if (received != sizeof(ServerRequest))
+    return 0;
+  header = CMSG_FIRSTHDR(&message);
+  xbt_assert(header && header->cmsg_type == SCM_RIGHTS,
+      "Request received without client");
+  memcpy(client, CMSG_DATA(header), sizeof(int));
+  request->dagfile[PATH_MAX - 1] = '\0';
+  return 1;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************              Processes of platforms             **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/*
+ * Display the allocations of the compute tasks ('root' and 'end' excluded) for
+ * an assumed size of the target cluster.
+ */
+static void server_print_allocations(const char *variant, int nworkstations){
+  int i;
+
+  for (i = 0; i < graph->ncompute; i++)
+    if (i != graph->root && i != graph->end)
+      printf("ALLOC:%s:%s:%d\n", variant, SD_task_get_name(graph->tasks[i]),
+          SD_task_get_iterative_allocations(graph->tasks[i], nworkstations));
+}
+
+/*
+ * Display the allocations of the compute tasks for the four variants and CPA.
+ */
+static void server_print_variant_allocations(BiCPA_result_t r){
+  server_print_allocations("biCPA-M", r->best_makespan_nworkstations);
+  server_print_allocations("biCPA-W", r->best_work_nworkstations);
+  server_print_allocations("biCPA-E", r->perfect_equity_nworkstations);
+  server_print_allocations("biCPA-S", r->min_sum_nworkstations);
+  server_print_allocations("CPA", r->nworkstations);
+}
+
+/*
+ * Serve a scheduling request, in a process forked for it, with the standard
+ * output redirected to the client. Results are first looked for in the result
+ * cache, if any. On a hit, only the allocations of the selected sizes are
+ * determined, to display those of the compute tasks.
+ */
+static void server_handle_request(ServerRequest *request, int client){
+  xbt_dynar_t dag;
+  BiCPA_result_t r;
+
+  dup2(client, STDOUT_FILENO);
+  close(client);
+
+  dagfile = request->dagfile;
+  XBT_VERB("Schedule '%s' on '%s'", dagfile, platform_file);
+  if (access(dagfile, R_OK)){
+    printf("ERROR cannot read DAG file '%s'\nEND\n", dagfile);
+  } else if ((r = result_cache_fetch(platform_file, dagfile))) {
+    print_biCPA_result(r);
+    dag = load_dag(dagfile);
+    set_selected_allocations(dag, r);
+    server_print_variant_allocations(r);
+    printf("END\n");
+    free_biCPA_result(r);
+    free_dag(dag);
+  } else {
+    dag = load_dag(dagfile);
+    r = compute_biCPA(dag);
+    print_biCPA_result(r);
+    server_print_variant_allocations(r);
+    printf("END\n");
+    result_cache_store(platform_file, dagfile, r);
+    free_biCPA_result(r);
+    free_dag(dag);
+  }
+  fflush(stdout);
+
+  stats->latencies[__sync_fetch_and_add(&(stats->nrequests), 1) %
+      SERVER_NLATENCIES] = get_time() - request->accept_time;
+  _exit(0);
+}
+
+/* Collect the handlers that are done, and count those that failed */
+static void server_collect_handlers(int options){
+  int status;
+
+  while (waitpid(-1, &status, options) > 0)
+    if (!WIFEXITED(status) || WEXITSTATUS(status))
+      __sync_fetch_and_add(&(stats->nfailures), 1);
+}
+
+/*
+ * Main loop of the process of a platform: load the platform, then fork a
+ * handler for each request received, until the server closes the channel.
+ */
+static void platform_server_run(PlatformServer *server){
+  int client;
+  pid_t pid;
+  ServerRequest request;
+
+  platform_file = server->platform_file;
+  load_platform(platform_file);
+  XBT_INFO("Platform '%s' loaded", platform_file);
+
+  while (server_receive_request(server->channel, &request, &client)){
+    server_collect_handlers(WNOHANG);
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    if (!pid){
+      close(server->channel);
+      server_handle_request(&request, client);
+    }
+    if (pid < 0){
+      XBT_WARN("Cannot fork a handler for '%s'", request.dagfile);
+      __sync_fetch_and_add(&(stats->nfailures), 1);
+    }
+    close(client);
+  }
+
+  server_collect_handlers(0);
+  free_platform();
+  _exit(0);
+}
+
+/*
+ * Return the process of a platform, forked on the first request for this
+ * platform. The other channels, the listening socket and the connections of
+ * the 'npending' clients whose requests are being read or served are closed in
+ * the new process, so that it only sees the end of its own channel and clients
+ * see the end of the replies.
+ */
+static PlatformServer *server_get_platform(PlatformServer **servers,
+    int *nservers, const char *platform, int listener, PendingClient *pending,
+    int npending){
+  int i, channels[2];
+  PlatformServer *server;
+
+  for (i = 0; i < *nservers; i++)
+    if (!strcmp((*servers)[i].platform_file, platform))
+      return &((*servers)[i]);
+
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, channels))
+    return NULL;
+
+  *servers = (PlatformServer*) realloc (*servers,
+      (*nservers + 1) * sizeof(PlatformServer));
+  server = &((*servers)[*nservers]);
+  server->platform_file = strdup(platform);
+  server->channel = channels[0];
+
+  fflush(stdout);
+  fflush(stderr);
+  server->pid = fork();
+  if (!server->pid){
+    for (i = 0; i < *nservers; i++)
+      close((*servers)[i].channel);
+    close(listener);
+    for (i = 0; i < npending; i++)
+      close(pending[i].fd);
+    close(channels[0]);
+    server->channel = channels[1];
+    signal(SIGINT, SIG_IGN);
+    signal(SIGTERM, SIG_DFL);
+    platform_server_run(server);
+  }
+  close(channels[1]);
+
+  if (server->pid < 0){
+    close(channels[0]);
+    free(server->platform_file);
+    return NULL;
+  }
+  (*nservers)++;
+  return server;
+}
+
+/* Forget the process of a platform that does not receive requests anymore */
+static void server_remove_platform(PlatformServer *servers, int *nservers,
+    PlatformServer *server){
+  close(server->channel);
+  waitpid(server->pid, NULL, 0);
+  free(server->platform_file);
+  *server = servers[--(*nservers)];
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************                  Server process                 **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+static int compare_latencies(const void *l1, const void *l2){
+  double d1 = *((double*) l1), d2 = *((double*) l2);
+
+  return (d1 < d2) ? -1 : (d1 > d2);
+}
+
+/* Nearest-rank percentile of 'n' sorted values */
+static double get_percentile(double *values, int n, double percentile){
+  int rank = (int) (percentile / 100. * n + 0.999999);
+
+  if (!n)
+    return 0.0;
+  return values[MAX(rank, 1) - 1];
+}
+
+static void server_reply_stats(FILE *client){
+  int n;
+  long nrequests = stats->nrequests;
+  double *latencies;
+
+  n = MIN(nrequests, SERVER_NLATENCIES);
+  latencies = (double*) calloc (MAX(n, 1), sizeof(double));
+  memcpy(latencies, stats->latencies, n * sizeof(double));
+  qsort(latencies, n, sizeof(double), compare_latencies);
+
+  fprintf(client, "requests:%ld\nfailures:%ld\n", nrequests,
+      stats->nfailures);
+  fprintf(client, "latency_p50:%.6f\nlatency_p90:%.6f\nlatency_p99:%.6f\n"
+      "latency_max:%.6f\nEND\n", get_percentile(latencies, n, 50),
+      get_percentile(latencies, n, 90), get_percentile(latencies, n, 99),
+      n ? latencies[n-1] : 0.0);
+  free(latencies);
+}
+
+/*
+ * Read what a client has sent of its request line, once poll() reported its
+ * connection as readable. Return 1 when the line is complete, 0 if more is
+ * expected, and -1 if the client closed the connection, or sent an empty or too
+ * long line.
+ */
+static int server_read_request(PendingClient *client){
+  ssize_t n;
+  char *end;
+  const int size = sizeof(client->line);
+
+  n = read(client->fd, client->line + client->length,
+      size - 1 - client->length);
+  if (n < 0 && (errno == EINTR || errno == EAGAIN))
+    return 0;
+  if (n <= 0)
+    return -1;
+  end = (char*) memchr(client->line + client->length, '\n', n);
+  client->length += n;
+  if (!end)
+    return (client->length == size - 1) ? -1 : 0;
+  *end = '\0';
+  if (end > client->line && end[-1] == '\r')
+    end[-1] = '\0';
+  return client->line[0] ? 1 : -1;
+}
+
+/*
+ * Serve the request of the 'current' pending client. Scheduling requests are
+ * sent to the process of their platform, with the client connection, and the
+ * other requests are served at once. The connection is then closed.
+ */
+static void server_serve_request(PendingClient *pending, int npending,
+    int current, PlatformServer **servers, int *nservers, int listener){
+  char command[16], platform[PATH_MAX], dag[PATH_MAX];
+  const char *line = pending[current].line;
+  int client = pending[current].fd;
+  FILE *reply;
+  ServerRequest request;
+  PlatformServer *server;
+
+  XBT_VERB("Request: %s", line);
+  reply = fdopen(client, "w");
+
+  if (sscanf(line, "%15s", command) != 1){
+    fprintf(reply, "ERROR empty request\nEND\n");
+  } else if (!strcmp(command, "STATS")){
+    server_reply_stats(reply);
+  } else if (!strcmp(command, "SHUTDOWN")){
+    fprintf(reply, "END\n");
+    server_stopped = 1;
+  } else if (strcmp(command, "SCHEDULE") ||
+      sscanf(line, "%*s %4095s %4095s", platform, dag) != 2){
+    fprintf(reply, "ERROR unknown request '%s'\nEND\n", line);
+  } else if (access(platform, R_OK)){
+    fprintf(reply, "ERROR cannot read platform file '%s'\nEND\n", platform);
+  } else {
+    memset(&request, 0, sizeof(ServerRequest));
+    request.accept_time = pending[current].accept_time;
+    snprintf(request.dagfile, PATH_MAX, "%s", dag);
+    server = server_get_platform(servers, nservers, platform, listener,
+        pending, npending);
+    if (server && !server_send_request(server->channel, &request, client)){
+      /* The process of the platform died, start a new one */
+      server_remove_platform(*servers, nservers, server);
+      server = server_get_platform(servers, nservers, platform, listener,
+          pending, npending);
+      if (server && !server_send_request(server->channel, &request, client))
+        server = NULL;
+    }
+    if (!server)
+      fprintf(reply, "ERROR cannot load platform '%s'\nEND\n", platform);
+  }
+  fclose(reply);
+}
+
+/*
+ * Run the scheduling server on the Unix domain socket 'socket_path', until a
+ * SHUTDOWN request, SIGINT, or SIGTERM. If a platform is given on the command
+ * line, it is loaded beforehand.
+ * The request lines of all the connected clients are read as they arrive, by
+ * polling their connections together with the listening socket, so that a slow
+ * or silent client does not delay the others. A client that did not send its
+ * request line within SERVER_REQUEST_TIMEOUT seconds is disconnected.
+ */
+void run_server(const char *socket_path){
+  int i, listener, client, status, nservers = 0, npending = 0;
+  double now;
+  struct sockaddr_un address;
+  struct sigaction action;
+  struct pollfd *fds = NULL;
+  PendingClient *pending = NULL;
+  PlatformServer *servers = NULL;
+
+  stats = (ServerStats) mmap(NULL, sizeof(struct _ServerStats),
+      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  xbt_assert(stats != MAP_FAILED, "Cannot allocate the server statistics");
+  memset(stats, 0, sizeof(struct _ServerStats));
+
+  memset(&action, 0, sizeof(struct sigaction));
+  action.sa_handler = server_stop;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  xbt_assert(strlen(socket_path) < sizeof(address.sun_path),
+      "Socket path '%s' is too long", socket_path);
+  memset(&address, 0, sizeof(struct sockaddr_un));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socket_path);
+  unlink(socket_path);
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  xbt_assert(listener >= 0 &&
+      !bind(listener, (struct sockaddr*) &address, sizeof(address)) &&
+      !listen(listener, 64), "Cannot listen on '%s'", socket_path);
+
+  if (platform_file)
+    xbt_assert(server_get_platform(&servers, &nservers, platform_file,
+        listener, NULL, 0), "Cannot start the process of platform '%s'",
+        platform_file);
+  XBT_INFO("Listening on '%s'", socket_path);
+
+  while (!server_stopped){
+    fds = (struct pollfd*) realloc (fds,
+        (npending + 1) * sizeof(struct pollfd));
+    fds[0].fd = listener;
+    fds[0].events = POLLIN;
+    for (i = 0; i < npending; i++){
+      fds[i+1].fd = pending[i].fd;
+      fds[i+1].events = POLLIN;
+    }
+    if (poll(fds, npending + 1, 1000) < 0)
+      continue;
+    now = get_time();
+
+    /*
+     * Serve the clients whose request line is complete, and disconnect those
+     * that failed or are too slow. Clients are removed by moving the last one
+     * in their place, which has already been seen.
+     */
+    for (i = npending - 1; i >= 0 && !server_stopped; i--){
+      status = fds[i+1].revents ? server_read_request(&(pending[i])) : 0;
+      if (!status && now - pending[i].accept_time > SERVER_REQUEST_TIMEOUT)
+        status = -1;
+      if (status > 0)
+        server_serve_request(pending, npending, i, &servers, &nservers,
+            listener);
+      else if (status < 0)
+        close(pending[i].fd);
+      if (status)
+        pending[i] = pending[--npending];
+    }
+
+    if (!server_stopped && (fds[0].revents & POLLIN) &&
+        (client = accept(listener, NULL, NULL)) >= 0){
+      pending = (PendingClient*) realloc (pending,
+          (npending + 1) * sizeof(PendingClient));
+      pending[npending].fd = client;
+      pending[npending].length = 0;
+      pending[npending++].accept_time = now;
+    }
+  }
+
+  XBT_INFO("Shutting down after %ld requests served and %ld failed",
+      stats->nrequests, stats->nfailures);
+  for (i = 0; i < npending; i++)
+    close(pending[i].fd);
+  free(pending);
+  free(fds);
+  while (nservers)
+    server_remove_platform(servers, &nservers, &(servers[nservers - 1]));
+  free(servers);
+  close(listener);
+  unlink(socket_path);
+  munmap(stats, sizeof(struct _ServerStats));
+}
+
+/*
+ * Client side: send a request line to the server listening on 'socket_path'
+ * and copy the reply on the standard output. Return 1 if the reply is complete,
+ * i.e., ends with an "END" line, and 0 otherwise.
+ */
+int send_request(const char *socket_path, const char *request){
+  int fd;
+  ssize_t n;
+  char buffer[4096], tail[4] = "";
+  struct sockaddr_un address;
+
+  if (strlen(socket_path) >= sizeof(address.sun_path)){
+    XBT_ERROR("Socket path '%s' is too long", socket_path);
+    return 0;
+  }
+  memset(&address, 0, sizeof(struct sockaddr_un));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socket_path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr*) &address, sizeof(address))){
+    XBT_ERROR("Cannot connect to '%s': %s", socket_path, strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return 0;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  if (write(fd, request, strlen(request)) != (ssize_t) strlen(request) ||
+      write(fd, "\n", 1) != 1){
+    XBT_ERROR("Cannot send the request to '%s'", socket_path);
+    close(fd);
+    return 0;
+  }
+
+  /* Keep the last four bytes to check that the reply ends with "END\n" */
+  while ((n = read(fd, buffer, sizeof(buffer))) > 0 ||
+         (n < 0 && errno == EINTR)){
+    if (n < 0)
+      continue;
+    fwrite(buffer, 1, n, stdout);
+    if (n >= 4)
+      memcpy(tail, buffer + n - 4, 4);
+    else {
+      memmove(tail, tail + n, 4 - n);
+      memcpy(tail + 4 - n, buffer, n);
+    }
+  }
+  fflush(stdout);
+  close(fd);
+  return !memcmp(tail, "END\n", 4);
+}
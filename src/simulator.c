@@ -0,0 +1,423 @@
+/******************************************************************************
+ * Copyright (c) 2010-2013. F. Suter
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the license (GNU LGPL 2.1) which comes with this package.
+ *****************************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simdag/simdag.h"
+#include "xbt.h"
+#include "arena.h"
+#include "graph.h"
+#include "simulator.h"
+#include "task.h"
+#include "timer.h"
+#include "workstation.h"
+
+XBT_LOG_NEW_DEFAULT_SUBCATEGORY(simulator, biCPA,
+    "Logging specific to simulators");
+
+/*
+ * Statistics on the SimGrid simulations of the process: number of simulations,
+ * time spent in them, and size of the resource dependencies that enforce the
+ * order of the tasks on each workstation.
+ */
+static long nsimgrid_simulations = 0;
+static double simgrid_time = 0.0;
+static long nresource_dependencies = 0;
+static double sequencing_bytes = 0.0;
+/* Simulated date at which the last SimGrid simulation started */
+static double simgrid_start_clock = 0.0;
+
+/*
+ * Tell whether the native engine simulates the schedules. Nothing is simulated
+ * in estimate-only mode, which screening also selects while it estimates all
+ * the schedules, whether cross-validation is requested or not.
+ */
+int native_engine_is_used(){
+  return simulator != ESTIMATE_ONLY &&
+      ((simulator == NATIVE_SIMULATOR) || (cross_validation_tolerance >= 0.));
+}
+
+/*
+ * Tell whether the SimGrid simulation engine has to be fed with the schedules,
+ * i.e., tasks have to be scheduled and resource dependencies added. As above,
+ * it is never the case in estimate-only mode.
+ */
+int simgrid_engine_is_used(){
+  return simulator != ESTIMATE_ONLY &&
+      ((simulator == SIMGRID_SIMULATOR) || (cross_validation_tolerance >= 0.));
+}
+
+/*
+ * Tell whether the makespan of a schedule is the one simulated by SimGrid.
+ */
+int simgrid_gives_makespan(){
+  return simulator == SIMGRID_SIMULATOR;
+}
+
+/*
+ * Run the SimGrid simulation of the schedule built by map_allocations() and
+ * return its makespan.
+ */
+double simulate_with_simgrid(xbt_dynar_t dag){
+  double start, start_time, makespan;
+  xbt_dynar_t executed_tasks;
+
+  start_time = get_time();
+  start = simgrid_start_clock = SD_get_clock ();
+  nresource_dependencies += graph->nresource_edges;
+  sequencing_bytes += 2.0 * graph->nresource_edges * sizeof(int);
+  executed_tasks = SD_simulate(-1.);
+  xbt_dynar_free_container(&executed_tasks);
+  makespan = SD_get_clock () - start;
+  nsimgrid_simulations++;
+  simgrid_time += get_time() - start_time;
+  return makespan;
+}
+
+/*
+ * Return the simulated date at which the last SimGrid simulation started, as
+ * the clock is not reset between simulations.
+ */
+double get_simgrid_start_clock(){
+  return simgrid_start_clock;
+}
+
+/*
+ * Report how the order of the tasks on the workstations was enforced in the
+ * SimGrid simulations of the process, and how long these simulations took.
+ */
+void report_simgrid_sequencing(){
+  if (!nsimgrid_simulations)
+    return;
+  XBT_VERB("SimGrid: %ld simulations in %.3f seconds, %ld resource "
+      "dependencies added (%.1f per schedule, %.1f KB recorded)",
+      nsimgrid_simulations, simgrid_time, nresource_dependencies,
+      (double) nresource_dependencies / nsimgrid_simulations,
+      sequencing_bytes / 1e3);
+}
+
+/*
+ * Binary min-heap of task identifiers, ordered by increasing 'finish' times.
+ * Ties are broken with identifiers to make the simulation deterministic.
+ */
+static int heap_less(const double *finish, int t1, int t2){
+  return (finish[t1] < finish[t2]) || (finish[t1] == finish[t2] && t1 < t2);
+}
+
+static void heap_push(int *heap, int *size, const double *finish, int task){
+  int i = (*size)++, parent;
+
+  while (i > 0){
+    parent = (i - 1) / 2;
+    if (!heap_less(finish, task, heap[parent]))
+      break;
+    heap[i] = heap[parent];
+    i = parent;
+  }
+  heap[i] = task;
+}
+
+static int heap_pop(int *heap, int *size, const double *finish){
+  int top = heap[0], last = heap[--(*size)], i = 0, child;
+
+  while ((child = 2 * i + 1) < *size){
+    if (child + 1 < *size && heap_less(finish, heap[child+1], heap[child]))
+      child++;
+    if (!heap_less(finish, heap[child], last))
+      break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = last;
+  return top;
+}
+
+/*
+ * Links of the platform, sorted by address to find their identifiers from the
+ * routes, and their bandwidths. The bytes sent on each link by a transfer are
+ * summed in 'bytes', whose entries are reset when a transfer first uses them,
+ * as told by 'stamp'.
+ */
+typedef struct _NativeNetwork {
+  int nlinks;
+  SD_link_t *links;
+  double *bandwidth;
+  int *fatpipe;
+  double *bytes;
+  int *stamp;
+} NativeNetwork;
+
+static int addressCompareLinks(const void *l1, const void *l2){
+  const SD_link_t link1 = *((const SD_link_t*) l1);
+  const SD_link_t link2 = *((const SD_link_t*) l2);
+
+  return (link1 < link2) ? -1 : (link1 > link2);
+}
+
+static void native_network_init(NativeNetwork *network){
+  int l;
+
+  network->nlinks = SD_link_get_number();
+  network->links = (SD_link_t*) arena_alloc(&schedule_arena,
+      network->nlinks * sizeof(SD_link_t));
+  memcpy(network->links, SD_link_get_list(),
+      network->nlinks * sizeof(SD_link_t));
+  qsort(network->links, network->nlinks, sizeof(SD_link_t),
+      addressCompareLinks);
+
+  network->bandwidth = (double*) arena_alloc(&schedule_arena,
+      network->nlinks * sizeof(double));
+  network->fatpipe = (int*) arena_alloc(&schedule_arena,
+      network->nlinks * sizeof(int));
+  network->bytes = (double*) arena_alloc(&schedule_arena,
+      network->nlinks * sizeof(double));
+  network->stamp = (int*) arena_alloc(&schedule_arena,
+      network->nlinks * sizeof(int));
+  for (l = 0; l < network->nlinks; l++){
+    network->bandwidth[l] =
+        SD_link_get_current_bandwidth(network->links[l]);
+    network->fatpipe[l] =
+        (SD_link_get_sharing_policy(network->links[l]) == SD_LINK_FATPIPE);
+  }
+}
+
+static int native_network_link_id(NativeNetwork *network, SD_link_t link){
+  SD_link_t *found = (SD_link_t*) bsearch(&link, network->links,
+      network->nlinks, sizeof(SD_link_t), addressCompareLinks);
+
+  xbt_assert(found, "Unknown link on a route");
+  return found - network->links;
+}
+
+/*
+ * Estimate the time to transfer 'size' bytes from compute task 'src' to compute
+ * task 'dst', as if the transfer were alone on the network. Both allocations
+ * are cut in as many blocks of data as they have workstations, and each pair of
+ * blocks that overlap is sent along the route between their workstations. As
+ * blocks are contiguous, these pairs are found in a single sweep of both
+ * allocations. The transfer waits for the largest latency of its routes, then
+ * goes at the rate of its most loaded link. A fatpipe link is only loaded by
+ * the largest block it carries.
+ */
+static double native_transfer_time(NativeNetwork *network, int src, int dst,
+    double size, int stamp){
+  const int src_size = graph->attributes[src].allocation_size;
+  const int dst_size = graph->attributes[dst].allocation_size;
+  SD_workstation_t *src_allocation = graph->attributes[src].allocation;
+  SD_workstation_t *dst_allocation = graph->attributes[dst].allocation;
+  int i = 0, j = 0, k, l, route_size;
+  double src_start, src_end, dst_start, dst_end, amount;
+  double latency = 0.0, duration = 0.0;
+  const SD_link_t *route;
+
+  while (i < src_size && j < dst_size){
+    src_start = i * size / src_size;
+    src_end = src_start + size / src_size;
+    dst_start = j * size / dst_size;
+    dst_end = dst_start + size / dst_size;
+    amount = MIN(src_end, dst_end) - MAX(src_start, dst_start);
+    if (amount > 0.){
+      route = SD_route_get_list(src_allocation[i], dst_allocation[j]);
+      route_size = SD_route_get_size(src_allocation[i], dst_allocation[j]);
+      latency = MAX(latency, SD_route_get_current_latency(src_allocation[i],
+          dst_allocation[j]));
+      for (k = 0; k < route_size; k++){
+        l = native_network_link_id(network, route[k]);
+        if (network->stamp[l] != stamp){
+          network->stamp[l] = stamp;
+          network->bytes[l] = 0.0;
+        }
+        if (network->fatpipe[l])
+          network->bytes[l] = MAX(network->bytes[l], amount);
+        else
+          network->bytes[l] += amount;
+        duration = MAX(duration, network->bytes[l] / network->bandwidth[l]);
+      }
+    }
+    if (src_end <= dst_end)
+      i++;
+    if (dst_end <= src_end)
+      j++;
+  }
+
+  return latency + duration;
+}
+
+/*
+ * Lightweight discrete-event simulation of the schedule built by
+ * map_allocations(), that replays it from the scheduler's own data
+ * structures. The schedule is fully determined by:
+ *   - the set of workstations of each compute task, on which it runs for the
+ *     time given by Amdahl's law,
+ *   - the precedence constraints of the DAG. The data sent along a flow
+ *     dependency arrive after the time given by native_transfer_time(), once
+ *     the source task is done.
+ *   - the order of the tasks on each workstation, i.e., the order of the tasks
+ *     in 'dag', that forms a chain of resource dependencies. It is the mapping
+ *     order, or the estimated start order with backfilling.
+ * A task starts when all its predecessors, in the DAG and on its
+ * workstations, are done. Events, i.e., task completions, are processed by
+ * increasing dates. The makespan is the date of the last event.
+ * This is an approximation for DAGs with transfer tasks: the transfers do not
+ * share the bandwidth of the links, so contention is not taken into account.
+ * The work arrays are taken from the arena of the current schedule.
+ */
+double simulate_natively(xbt_dynar_t dag){
+  unsigned int cursor;
+  int i, j, t, c, host, nslots = 0, nheap = 0, nstarted = 0, nmapped = 0;
+  int stamp = 0;
+  const int nworkstations = SD_workstation_get_number();
+  int *pending, *first_slot, *next_on_host, *last_slot, *heap;
+  double makespan = 0.0, arrival, *ready, *finish;
+  SD_task_t task;
+  TaskAttribute attr;
+  NativeNetwork network;
+
+  pending = (int*) arena_alloc(&schedule_arena, graph->ncompute * sizeof(int));
+  first_slot = (int*) arena_alloc(&schedule_arena,
+      graph->ncompute * sizeof(int));
+  heap = (int*) arena_alloc(&schedule_arena, graph->ncompute * sizeof(int));
+  ready = (double*) arena_alloc(&schedule_arena,
+      graph->ncompute * sizeof(double));
+  finish = (double*) arena_alloc(&schedule_arena,
+      graph->ncompute * sizeof(double));
+  last_slot = (int*) arena_alloc(&schedule_arena, nworkstations * sizeof(int));
+
+  memset(&network, 0, sizeof(NativeNetwork));
+  if (graph->ntasks > graph->ncompute)
+    native_network_init(&network);
+
+  /*
+   * Each (task, workstation) pair of the schedule is a slot. Slots of a task
+   * are contiguous and follow the mapping order.
+   */
+  for (i = 0; i < graph->ncompute; i++)
+    first_slot[i] = -1;
+  xbt_dynar_foreach(dag, cursor, task){
+    if (SD_task_get_kind(task) != SD_TASK_COMP_PAR_AMDAHL)
+      continue;
+    attr = (TaskAttribute) SD_task_get_data(task);
+    if (!attr->allocation)
+      continue;
+    first_slot[attr->id] = nslots;
+    nslots += attr->allocation_size;
+    nmapped++;
+  }
+
+  /* Build the per-workstation chains, in mapping order */
+  next_on_host = (int*) arena_alloc(&schedule_arena, nslots * sizeof(int));
+  for (i = 0; i < nslots; i++)
+    next_on_host[i] = -1;
+  for (i = 0; i < nworkstations; i++)
+    last_slot[i] = -1;
+
+  xbt_dynar_foreach(dag, cursor, task){
+    if (SD_task_get_kind(task) != SD_TASK_COMP_PAR_AMDAHL)
+      continue;
+    attr = (TaskAttribute) SD_task_get_data(task);
+    if (first_slot[attr->id] < 0)
+      continue;
+    for (j = 0; j < attr->allocation_size; j++){
+      host = SD_workstation_get_id(attr->allocation[j]);
+      if (last_slot[host] >= 0){
+        next_on_host[last_slot[host]] = attr->id;
+        pending[attr->id]++;
+      }
+      last_slot[host] = first_slot[attr->id] + j;
+    }
+    for (i = graph->parent_index[attr->id];
+        i < graph->parent_index[attr->id+1]; i++)
+      if (first_slot[graph->parents[i]] >= 0)
+        pending[attr->id]++;
+  }
+
+  /* Start the tasks that have no predecessor */
+  for (t = 0; t < graph->ncompute; t++)
+    if (first_slot[t] >= 0 && !pending[t]){
+      finish[t] = ready[t] + SD_task_estimate_execution_time(graph->tasks[t],
+          graph->attributes[t].allocation_size);
+      heap_push(heap, &nheap, finish, t);
+      nstarted++;
+    }
+
+  while (nheap){
+    t = heap_pop(heap, &nheap, finish);
+    if (finish[t] > makespan)
+      makespan = finish[t];
+
+    /* Release the children of the task once their data have arrived */
+    for (i = graph->child_index[t]; i < graph->child_index[t+1]; i++){
+      c = graph->children[i];
+      if (first_slot[c] < 0)
+        continue;
+      arrival = finish[t];
+      if (graph->child_transfers[i])
+        arrival += native_transfer_time(&network, t, c, graph->child_sizes[i],
+            ++stamp);
+      if (arrival > ready[c])
+        ready[c] = arrival;
+      if (!--pending[c]){
+        finish[c] = ready[c] + SD_task_estimate_execution_time(
+            graph->tasks[c], graph->attributes[c].allocation_size);
+        heap_push(heap, &nheap, finish, c);
+        nstarted++;
+      }
+    }
+
+    /* Release the next task on each of the workstations of the task */
+    for (j = 0; j < graph->attributes[t].allocation_size; j++){
+      c = next_on_host[first_slot[t] + j];
+      if (c < 0)
+        continue;
+      if (finish[t] > ready[c])
+        ready[c] = finish[t];
+      if (!--pending[c]){
+        finish[c] = ready[c] + SD_task_estimate_execution_time(
+            graph->tasks[c], graph->attributes[c].allocation_size);
+        heap_push(heap, &nheap, finish, c);
+        nstarted++;
+      }
+    }
+  }
+
+  xbt_assert(nstarted == nmapped,
+      "Native simulation stalled: %d tasks out of %d executed", nstarted,
+      nmapped);
+
+  return makespan;
+}
+
+/*
+ * Return the makespan of the current schedule, as given by the selected
+ * simulation engine. In cross-validation mode, both engines are run and their
+ * makespans must agree within the relative tolerance given as a parameter.
+ */
+double simulate_makespan(xbt_dynar_t dag){
+  double makespan, other_makespan;
+
+  if (simulator == NATIVE_SIMULATOR)
+    makespan = simulate_natively(dag);
+  else
+    makespan = simulate_with_simgrid(dag);
+
+  if (cross_validation_tolerance >= 0.){
+    if (simulator == NATIVE_SIMULATOR)
+      other_makespan = simulate_with_simgrid(dag);
+    else
+      other_makespan = simulate_natively(dag);
+    XBT_VERB("Cross-validation: makespan = %.3f (native) vs. %.3f (SimGrid)",
+        (simulator == NATIVE_SIMULATOR) ? makespan : other_makespan,
+        (simulator == NATIVE_SIMULATOR) ? other_makespan : makespan);
+    xbt_assert(fabs(makespan - other_makespan) <=
+        cross_validation_tolerance * MAX(makespan, other_makespan),
+        "Simulation engines disagree: makespan = %.3f vs. %.3f", makespan,
+        other_makespan);
+  }
+
+  return makespan;
+}
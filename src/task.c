@@ -5,9 +5,14 @@
  * This program is free software; you can redistribute it and/or modify it
  * under the terms of the license (GNU LGPL 2.1) which comes with this package.
  *****************************************************************************/
+#include "simdag/simdag.h"
+#include "arena.h"
+#include "bicpa.h"
+#include "graph.h"
 #include "task.h"
 #include "workstation.h"
 #include <stdlib.h>
+#include <string.h>
 
 XBT_LOG_NEW_DEFAULT_SUBCATEGORY(task, biCPA, "Logging specific to tasks");
 
@@ -17,23 +22,30 @@ XBT_LOG_NEW_DEFAULT_SUBCATEGORY(task, biCPA, "Logging specific to tasks");
 /*****************************************************************************/
 /*****************************************************************************/
 
-void SD_task_allocate_attribute(SD_task_t task){
-  const int nworkstations = SD_workstation_get_number();
-  TaskAttribute attr = calloc(1,sizeof(struct _TaskAttribute));
+/*
+ * Attach an attribute to a task. Attributes are not allocated one by one, but
+ * are taken from the contiguous array held by the compact view of the DAG. The
+ * identifier of the task in this view is stored in the attribute.
+ */
+void SD_task_allocate_attribute(SD_task_t task, TaskAttribute attr, int id){
+  attr->id = id;
   attr->marked = 0;
   attr->allocation_size = 1;
-  attr->iterative_allocations = (int*) calloc (nworkstations, sizeof(int));
   SD_task_set_data(task, attr);
 }
 
 void SD_task_free_attribute(SD_task_t task){
   TaskAttribute attr = (TaskAttribute) SD_task_get_data(task);
-  free(attr->allocation);
-  free(attr->iterative_allocations);
-  free(attr);
+  free(attr->change_nworkstations);
+  free(attr->change_allocations);
   SD_task_set_data(task, NULL);
 }
 
+int SD_task_get_id(SD_task_t task){
+  TaskAttribute attr = (TaskAttribute) SD_task_get_data(task);
+  return attr->id;
+}
+
 double SD_task_get_bottom_level( SD_task_t task){
   TaskAttribute attr = (TaskAttribute) SD_task_get_data(task);
   return attr->bottom_level;
@@ -83,28 +95,118 @@ SD_workstation_t *SD_task_get_allocation(SD_task_t task){
   return attr->allocation;
 }
 
+/*
+ * Number of words of the bitsets of workstations, and position of the bit of
+ * a given workstation in these bitsets.
+ */
+#define BITS_PER_WORD (8 * sizeof(unsigned long))
+#define BITSET_NWORDS ((SD_workstation_get_number() + BITS_PER_WORD - 1) / \
+    BITS_PER_WORD)
+#define BITSET_WORD(id) ((id) / BITS_PER_WORD)
+#define BITSET_MASK(id) (1UL << ((id) % BITS_PER_WORD))
+
+/*
+ * The allocation of a task is taken from the arena of the current schedule,
+ * and released with it. Its bitset is kept for the DAG.
+ */
 void SD_task_set_allocation(SD_task_t task,
     SD_workstation_t *workstation_list){
-  int i;
+  int i, id;
   TaskAttribute attr = (TaskAttribute) SD_task_get_data(task);
-  if (attr->allocation)
-    free(attr->allocation);
-  attr->allocation = (SD_workstation_t*) calloc (attr->allocation_size,
-      sizeof(SD_workstation_t));
+  attr->allocation = (SD_workstation_t*) arena_alloc(&schedule_arena,
+      attr->allocation_size * sizeof(SD_workstation_t));
+  if (!attr->allocation_bitset)
+    attr->allocation_bitset = (unsigned long*) arena_alloc(&dag_arena,
+        BITSET_NWORDS * sizeof(unsigned long));
+  else
+    memset(attr->allocation_bitset, 0, BITSET_NWORDS * sizeof(unsigned long));
+
   for (i = 0; i < attr->allocation_size; i++){
     attr->allocation[i] = workstation_list[i];
+    id = SD_workstation_get_id(workstation_list[i]);
+    attr->allocation_bitset[BITSET_WORD(id)] |= BITSET_MASK(id);
   }
   SD_task_set_data(task, attr);
 }
 
+/*
+ * Return the number of change points of the iterative allocations of a task
+ * whose assumed size is not larger than 'index' (binary search).
+ */
+static int SD_task_count_changes(TaskAttribute attr, int index){
+  int low = 0, high = attr->nchanges, middle;
+
+  while (low < high){
+    middle = (low + high) / 2;
+    if (attr->change_nworkstations[middle] <= index)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
 int SD_task_get_iterative_allocations (SD_task_t task, int index){
   TaskAttribute attr = (TaskAttribute) SD_task_get_data(task);
-  return attr->iterative_allocations[index-1];
+  int position = SD_task_count_changes(attr, index);
+
+  return position ? attr->change_allocations[position-1] : 0;
 }
 
+/*
+ * Store the allocation of a task for the assumed size 'index'. Sizes are
+ * usually stored in increasing order, hence appended, but sampling also
+ * inserts sizes between those already stored. A change point is only added if
+ * the allocation differs from that of the previous one, and the next change
+ * point is removed if it does not change the allocation anymore.
+ */
 void SD_task_set_iterative_allocations (SD_task_t task, int index, int size){
   TaskAttribute attr = (TaskAttribute) SD_task_get_data(task);
-  attr->iterative_allocations[index-1] = size;
+  int position = SD_task_count_changes(attr, index);
+
+  if (position && attr->change_nworkstations[position-1] == index){
+    attr->change_allocations[--position] = size;
+  } else if (!position || attr->change_allocations[position-1] != size){
+    if (attr->nchanges == attr->changes_size){
+      attr->changes_size = attr->changes_size ? 2 * attr->changes_size : 4;
+      attr->change_nworkstations = (int*) realloc (attr->change_nworkstations,
+          attr->changes_size * sizeof(int));
+      attr->change_allocations = (int*) realloc (attr->change_allocations,
+          attr->changes_size * sizeof(int));
+    }
+    memmove(attr->change_nworkstations + position + 1,
+        attr->change_nworkstations + position,
+        (attr->nchanges - position) * sizeof(int));
+    memmove(attr->change_allocations + position + 1,
+        attr->change_allocations + position,
+        (attr->nchanges - position) * sizeof(int));
+    attr->change_nworkstations[position] = index;
+    attr->change_allocations[position] = size;
+    attr->nchanges++;
+  } else {
+    return;
+  }
+
+  if (position + 1 < attr->nchanges &&
+      attr->change_allocations[position+1] == size){
+    memmove(attr->change_nworkstations + position + 1,
+        attr->change_nworkstations + position + 2,
+        (attr->nchanges - position - 2) * sizeof(int));
+    memmove(attr->change_allocations + position + 1,
+        attr->change_allocations + position + 2,
+        (attr->nchanges - position - 2) * sizeof(int));
+    attr->nchanges--;
+  }
+}
+
+double SD_task_get_estimated_start_time(SD_task_t task){
+  TaskAttribute attr = (TaskAttribute) SD_task_get_data(task);
+  return attr->estimated_start_time;
+}
+
+void SD_task_set_estimated_start_time(SD_task_t task, double start_time){
+  TaskAttribute attr = (TaskAttribute) SD_task_get_data(task);
+  attr->estimated_start_time = start_time;
   SD_task_set_data(task, attr);
 }
 
@@ -137,10 +239,38 @@ int bottomLevelCompareTasks(const void *n1, const void *n2)
   bottom_level1 = SD_task_get_bottom_level((*((SD_task_t *)n1)));
   bottom_level2 = SD_task_get_bottom_level((*((SD_task_t *)n2)));
 
+  /*
+   * Ties are broken with the identifiers of the tasks. The resulting order is
+   * thus independent of the previous order of the tasks, and schedules built
+   * one after the other or by separate workers are the same.
+   */
   if (bottom_level1 > bottom_level2)
     return -1;
   else if (bottom_level1 == bottom_level2)
-    return 0;
+    return SD_task_get_id((*((SD_task_t *)n1))) -
+        SD_task_get_id((*((SD_task_t *)n2)));
+  else
+    return 1;
+}
+
+/*
+ * With backfilling, a task may be mapped before tasks that were mapped earlier
+ * on some of its workstations. The tasks are then sorted by increasing
+ * estimated start time to get the order of the tasks on each workstation. Ties
+ * are broken by the mapping order, in which the predecessors of a task come
+ * first.
+ */
+int startTimeCompareTasks(const void *n1, const void *n2)
+{
+  double start_time1, start_time2;
+
+  start_time1 = SD_task_get_estimated_start_time((*((SD_task_t *)n1)));
+  start_time2 = SD_task_get_estimated_start_time((*((SD_task_t *)n2)));
+
+  if (start_time1 < start_time2)
+    return -1;
+  else if (start_time1 == start_time2)
+    return bottomLevelCompareTasks(n1, n2);
   else
     return 1;
 }
@@ -184,20 +314,14 @@ int SD_task_is_marked(SD_task_t task){
  * as input on a given number of workstations. The task has to be of kind
  * SD_TASK_COMP_PAR_AMDAHL, as Amdahl's law is applied to get this estimation.
  * It also assumes a fully homogeneous set of workstations as no distinction is
- * made within the whole set.
+ * made within the whole set. The coefficients of Amdahl's law are precomputed
+ * in the compact view of the DAG.
  */
 double SD_task_estimate_execution_time(SD_task_t task, int nworkstations){
-  const SD_workstation_t *workstations = SD_workstation_get_list();
-  double amount, alpha, power, estimate;
+  int id = SD_task_get_id(task);
 
-  amount = SD_task_get_amount(task);
-  alpha = SD_task_get_alpha(task);
-  power = SD_workstation_get_power(workstations[0]);
-  estimate = (alpha + (1 - alpha)/nworkstations) * (amount/power);
-
-  XBT_DEBUG("Estimation for task %s is: %f seconds",
-      SD_task_get_name(task), estimate);
-  return estimate;
+  return (graph->alpha[id] + graph->parallel_fraction[id]/nworkstations) *
+      graph->sequential_time[id];
 }
 /*
  * Return a rough estimation of what would be the area taken by the task given
@@ -209,38 +333,125 @@ double SD_task_estimate_area(SD_task_t task, int nworkstations) {
   return SD_task_estimate_execution_time(task, nworkstations) * nworkstations;
 }
 
+/*
+ * Batch counterparts of the two functions above, plus the estimation of the
+ * gain of an extra workstation, i.e., T(n)/n - T(n+1)/(n+1). They process
+ * 'count' (task, number of workstations) pairs at once: the identifiers of the
+ * tasks are given in 'ids' and the numbers of workstations in 'n'. If 'ids' is
+ * NULL, the pairs concern the compute tasks 0 to count-1. A same task can also
+ * appear several times to be evaluated for many numbers of workstations. Loops
+ * are written over contiguous arrays so that they are vectorized.
+ */
+void SD_task_estimate_execution_times(int count, const int *ids, const int *n,
+    double *times){
+  int i;
+  const double * restrict alpha = graph->alpha;
+  const double * restrict parallel_fraction = graph->parallel_fraction;
+  const double * restrict sequential_time = graph->sequential_time;
+
+  if (ids) {
+#pragma omp simd
+    for (i = 0; i < count; i++)
+      times[i] = (alpha[ids[i]] + parallel_fraction[ids[i]]/n[i]) *
+          sequential_time[ids[i]];
+  } else {
+#pragma omp simd
+    for (i = 0; i < count; i++)
+      times[i] = (alpha[i] + parallel_fraction[i]/n[i]) * sequential_time[i];
+  }
+}
+
+void SD_task_estimate_areas(int count, const int *ids, const int *n,
+    double *areas){
+  int i;
+
+  SD_task_estimate_execution_times(count, ids, n, areas);
+#pragma omp simd
+  for (i = 0; i < count; i++)
+    areas[i] = areas[i] * n[i];
+}
+
+void SD_task_estimate_gains(int count, const int *ids, const int *n,
+    double *gains){
+  int i, id;
+  const double * restrict alpha = graph->alpha;
+  const double * restrict parallel_fraction = graph->parallel_fraction;
+  const double * restrict sequential_time = graph->sequential_time;
+
+#pragma omp simd private(id)
+  for (i = 0; i < count; i++){
+    id = ids ? ids[i] : i;
+    gains[i] =
+        (alpha[id] + parallel_fraction[id]/n[i]) * sequential_time[id] / n[i] -
+        (alpha[id] + parallel_fraction[id]/(n[i]+1)) * sequential_time[id] /
+        (n[i]+1);
+  }
+}
+
 /*
  * Return an estimation of the minimal time before which a task can start. This
  * time depends on the estimated finished time of the compute ancestors of the
- * task, as set when they have been scheduled. Two cases are considered,
- * depending on whether an ancestor is 'linked' to the task through a flow or
- * control dependency. Flow dependencies imply to look at the grand parents of
- * the task, while control dependencies look at the parent tasks directly.
+ * task, as set when they have been scheduled. Whether an ancestor is 'linked'
+ * to the task through a flow or control dependency, it is found directly among
+ * the compute parents of the task in the compact view of the DAG.
  */
 double SD_task_estimate_minimal_start_time(SD_task_t task){
-  unsigned int i;
+  int i, id = SD_task_get_id(task);
   double min_start_time=0.0;
-  xbt_dynar_t parents, grand_parents;
-  SD_task_t parent, grand_parent;
 
-  parents = SD_task_get_parents(task);
-  xbt_dynar_foreach(parents, i, parent){
-    if (SD_task_get_kind(parent) == SD_TASK_COMM_PAR_MXN_1D_BLOCK) {
-      grand_parents = SD_task_get_parents(parent);
-      xbt_dynar_get_cpy(grand_parents, 0, &grand_parent);
-        if (SD_task_get_estimated_finish_time(grand_parent) > min_start_time)
-          min_start_time = SD_task_get_estimated_finish_time(grand_parent);
-      xbt_dynar_free_container(&grand_parents);
-    }
-    else{
-      if (SD_task_get_estimated_finish_time(parent) > min_start_time)
-        min_start_time = SD_task_get_estimated_finish_time(parent);
-    }
-  }
-  xbt_dynar_free_container(&parents);
+  for (i = graph->parent_index[id]; i < graph->parent_index[id+1]; i++)
+    if (graph->attributes[graph->parents[i]].estimated_finish_time >
+        min_start_time)
+      min_start_time =
+          graph->attributes[graph->parents[i]].estimated_finish_time;
+
   return min_start_time;
 }
 
+/*
+ * Return the identifier of the first workstation of a bitset that is not
+ * 'excluded', or -1 if there is none.
+ */
+static int bitset_first_workstation(const unsigned long *bitset, int nwords,
+    int excluded){
+  int i;
+  unsigned long word;
+
+  for (i = 0; i < nwords; i++){
+    word = bitset[i];
+    if (excluded >= 0 && BITSET_WORD(excluded) == i)
+      word &= ~BITSET_MASK(excluded);
+    if (word)
+      return i * BITS_PER_WORD + __builtin_ctzl(word);
+  }
+  return -1;
+}
+
+/*
+ * Time to send 'size' bytes along a route from 'src_size' workstations to
+ * 'dst_size' workstations, as detailed below.
+ */
+static double estimate_route_transfer_time(RouteSummary route, double size,
+    int src_size, int dst_size){
+  double transfer_time = 0.0;
+
+  if (route->nlinks){
+    /* first link */
+    transfer_time = size / (route->first_bandwidth * src_size);
+
+    /* links in between */
+    if (route->middle_bandwidth &&
+        transfer_time < size / route->middle_bandwidth)
+      transfer_time = size / route->middle_bandwidth;
+
+    /* last link */
+    if (transfer_time < size / (route->last_bandwidth * dst_size))
+      transfer_time = size / (route->last_bandwidth * dst_size);
+  }
+
+  return transfer_time + route->latency;
+}
+
 /*
  * Return a rough estimation of the time needed to transfer 'size' bytes of data
  * between two allocated tasks 'src' and 'dst'. Two cases are distinguished:
@@ -257,93 +468,43 @@ double SD_task_estimate_minimal_start_time(SD_task_t task){
  *  - the sum of the link's latencies on the route
  * This estimation doesn't take concurrent transfers (and then bandwidth sharing
  * between them) into account. Transfer times are thus underestimated.
+ * Workstations are considered by increasing identifiers, i.e., in the order of
+ * their names. Allocations are compared through their bitsets and the routes
+ * are read from the route cache.
 */
 double SD_task_estimate_transfer_time_from(SD_task_t src, SD_task_t dst,
     double size){
-  int src_allocation_size, dst_allocation_size;
-  SD_workstation_t *src_allocation, *dst_allocation;
-  const SD_link_t* route=NULL;
-  int route_size;
+  TaskAttribute src_attr = (TaskAttribute) SD_task_get_data(src);
+  TaskAttribute dst_attr = (TaskAttribute) SD_task_get_data(dst);
+  const int nwords = BITSET_NWORDS;
+  int src_id, dst_id;
   double transfer_time =0.0;
-  int src_index = -1, dst_index=-1;
-  int i, s, d;;
-
-  src_allocation_size = SD_task_get_allocation_size(src);
-  src_allocation = SD_task_get_allocation(src);
-  dst_allocation_size = SD_task_get_allocation_size(dst);
-  dst_allocation = SD_task_get_allocation(dst);
-
-  qsort((void *)src_allocation,src_allocation_size, sizeof(SD_workstation_t),
-      nameCompareWorkstations);
-  qsort((void *)dst_allocation,dst_allocation_size, sizeof(SD_workstation_t),
-      nameCompareWorkstations);
-
-  i = 0;
-  if (src_allocation_size == dst_allocation_size) {
-    for (s = 0; s < src_allocation_size; s++) {
-      for (d = 0; d < dst_allocation_size; d++) {
-        if (!strcmp(SD_workstation_get_name (src_allocation[s]),
-            SD_workstation_get_name (dst_allocation[d]))) {
-          i++;
-          break;
-        }
-      }
-      if (i <= s)
-        break;
-    }
-  }
+  RouteSummary route;
+
+  src_id = bitset_first_workstation(src_attr->allocation_bitset, nwords, -1);
 
-  if (i == src_allocation_size) {
+  if (src_attr->allocation_size == dst_attr->allocation_size &&
+      !memcmp(src_attr->allocation_bitset, dst_attr->allocation_bitset,
+          nwords * sizeof(unsigned long))) {
     /* both configurations are identical. Let just consider the transfer between
      * the first workstation of each set */
-    route= SD_route_get_list (src_allocation[0], dst_allocation[0]);
-    route_size = SD_route_get_size(src_allocation[0], dst_allocation[0]);
-    src_index=dst_index=0;
+    dst_id = src_id;
   } else {
     /* Found 2 different hosts. The first host belongs to src
-       and the second one belongs to dst. Then
-       compute the transfer time walking through the route between
-       them */
-    for (s = 0; s < src_allocation_size; s++) {
-      for (d = 0; d < dst_allocation_size; d++) {
-        if (strcmp(SD_workstation_get_name (src_allocation[s]),
-            SD_workstation_get_name (dst_allocation[d]))) {
-          src_index = s;
-          dst_index = d;
-          break;
-        }
-      }
-      if (src_index != -1)
-        break;
+       and the second one belongs to dst. If the only host of dst is the first
+       host of src, the second host of src is taken instead. */
+    dst_id = bitset_first_workstation(dst_attr->allocation_bitset, nwords,
+        src_id);
+    if (dst_id < 0){
+      dst_id = src_id;
+      src_id = bitset_first_workstation(src_attr->allocation_bitset, nwords,
+          dst_id);
     }
-    route= SD_route_get_list (src_allocation[src_index],
-        dst_allocation[dst_index]);
-    route_size = SD_route_get_size(src_allocation[src_index],
-        dst_allocation[dst_index]);
   }
 
- /* first link */
-  transfer_time = size/
-      (SD_link_get_current_bandwidth(route[0])*src_allocation_size);
-
-  for (i = 1; i < route_size - 1; i++) {
-    if (transfer_time < (size /
-        SD_link_get_current_bandwidth(route[i])))
-      transfer_time = size / SD_link_get_current_bandwidth(route[i]);
-  }
-
-  /* last link */
-  if (transfer_time < size /
-      (SD_link_get_current_bandwidth(route[route_size-1]) *
-          dst_allocation_size)){
-    transfer_time = size /
-        (SD_link_get_current_bandwidth(route[route_size-1]) *
-            dst_allocation_size);
-  }
-
-  transfer_time +=
-      SD_route_get_current_latency (src_allocation[src_index],
-          dst_allocation[dst_index]);
+  route = get_route_summary(src_id, dst_id);
+  transfer_time = estimate_route_transfer_time(route, size,
+      src_attr->allocation_size, dst_attr->allocation_size);
   XBT_VERB("Estimated transfer time between tasks '%s' and '%s': %.3f",
       SD_task_get_name(src), SD_task_get_name(dst),transfer_time);
   return transfer_time;
@@ -358,34 +519,67 @@ double SD_task_estimate_transfer_time_from(SD_task_t src, SD_task_t dst,
  * part is obviously discarded.
  */
 double SD_task_estimate_last_data_arrival_time (SD_task_t task){
-  unsigned int i;
+  int i, id = SD_task_get_id(task);
   double last_data_arrival = -1., data_availability, estimated_transfer_time;
-  SD_task_t parent, grand_parent;
-  xbt_dynar_t parents, grand_parents;
-
-  parents = SD_task_get_parents(task);
+  SD_task_t grand_parent;
 
-  xbt_dynar_foreach(parents, i, parent){
-    if (SD_task_get_kind(parent) == SD_TASK_COMM_PAR_MXN_1D_BLOCK) {
-      grand_parents = SD_task_get_parents(parent);
-      xbt_dynar_get_cpy(grand_parents, 0, &grand_parent);
+  for (i = graph->parent_index[id]; i < graph->parent_index[id+1]; i++){
+    grand_parent = graph->tasks[graph->parents[i]];
+    if (graph->parent_transfers[i]) {
       estimated_transfer_time =
           SD_task_estimate_transfer_time_from(grand_parent, task,
-              SD_task_get_amount(parent));
+              graph->parent_sizes[i]);
       data_availability = SD_task_get_estimated_finish_time(grand_parent)+
           estimated_transfer_time;
-      xbt_dynar_free_container(&grand_parents);
     } else {
-      data_availability = SD_task_get_estimated_finish_time(parent);
+      data_availability = SD_task_get_estimated_finish_time(grand_parent);
     }
 
     if (last_data_arrival < data_availability)
       last_data_arrival = data_availability;
   }
-  xbt_dynar_free_container(&parents);
   return last_data_arrival;
 }
 
+/*
+ * Estimate the time to redistribute the data sent along the 'edge'-th child
+ * edge of the compact view of the DAG, from compute task 'id' to its child,
+ * given only the sizes of their current allocations, as needed by the M-CPA
+ * allocation procedure before any mapping. The estimation follows
+ * SD_task_estimate_transfer_time_from(): allocations of the same size may be
+ * mapped on the same workstations, hence a route from a workstation to itself,
+ * while other allocations need a route between two distinct workstations. The
+ * first workstations of the platform stand for all of them. Control
+ * dependencies cost nothing.
+ * The estimation is not memoized: it only reads a cached route summary, which
+ * costs about as much as a lookup in a memo table would.
+ */
+double SD_task_estimate_redistribution_time(int id, int edge){
+  int src_size, dst_size, dst_id;
+
+  if (!graph->child_transfers[edge])
+    return 0.0;
+
+  src_size = graph->attributes[id].allocation_size;
+  dst_size = graph->attributes[graph->children[edge]].allocation_size;
+  dst_id = (src_size == dst_size || SD_workstation_get_number() == 1) ? 0 : 1;
+  return estimate_route_transfer_time(get_route_summary(0, dst_id),
+      graph->child_sizes[edge], src_size, dst_size);
+}
+
+/*
+ * Bottom level of the child of compute task 'id' along its 'edge'-th child
+ * edge, as seen from 'id'. With the M-CPA allocation, the estimated time to
+ * redistribute the data sent along the edge is added.
+ */
+double SD_task_estimate_child_bottom_level(int id, int edge){
+  double bottom_level = graph->attributes[graph->children[edge]].bottom_level;
+
+  if (mcpa_allocation)
+    bottom_level += SD_task_estimate_redistribution_time(id, edge);
+  return bottom_level;
+}
+
 /*****************************************************************************/
 /*****************************************************************************/
 /**************              DFS internal functions             **************/
@@ -393,44 +587,26 @@ double SD_task_estimate_last_data_arrival_time (SD_task_t task){
 /*****************************************************************************/
 
 double bottom_level_recursive_computation(SD_task_t task){
-  unsigned int i;
+  int i, child, id = SD_task_get_id(task);
   double my_bottom_level = 0.0, max_bottom_level,
       current_child_bottom_level = 0.0;
-  SD_task_t child, grand_child;
-  xbt_dynar_t children, grand_children;
 
   my_bottom_level = SD_task_estimate_execution_time(task,
-      SD_task_get_allocation_size(task));
+      graph->attributes[id].allocation_size);
 
   max_bottom_level = -1.0;
-  if (!strcmp(SD_task_get_name(task),"end")){
+  if (id == graph->end){
     XBT_DEBUG("end's bottom level is 0.0");
-    SD_task_mark(task);
-    SD_task_set_bottom_level(task, 0.0);
+    graph->attributes[id].marked = 1;
+    graph->attributes[id].bottom_level = 0.0;
     return 0.0;
   }
 
-  children = SD_task_get_children(task);
-
-  xbt_dynar_foreach(children, i, child){
-    if (SD_task_get_kind(child) == SD_TASK_COMM_PAR_MXN_1D_BLOCK) {
-      grand_children = SD_task_get_children(child);
-      xbt_dynar_get_cpy(grand_children, 0, &grand_child);
-      if (SD_task_is_marked(grand_child)){
-        current_child_bottom_level = SD_task_get_bottom_level(grand_child);
-      } else {
-        current_child_bottom_level =
-            bottom_level_recursive_computation(grand_child);
-      }
-      xbt_dynar_free_container(&grand_children);
-    } else {
-      if (SD_task_is_marked(child)){
-        current_child_bottom_level = SD_task_get_bottom_level(child);
-      } else {
-        current_child_bottom_level =
-            bottom_level_recursive_computation(child);
-      }
-    }
+  for (i = graph->child_index[id]; i < graph->child_index[id+1]; i++){
+    child = graph->children[i];
+    if (!graph->attributes[child].marked)
+      bottom_level_recursive_computation(graph->tasks[child]);
+    current_child_bottom_level = SD_task_estimate_child_bottom_level(id, i);
 
     if (max_bottom_level < current_child_bottom_level)
       max_bottom_level = current_child_bottom_level;
@@ -438,14 +614,36 @@ double bottom_level_recursive_computation(SD_task_t task){
 
   my_bottom_level += max_bottom_level;
 
-  SD_task_set_bottom_level(task, my_bottom_level);
-  SD_task_mark(task);
+  graph->attributes[id].bottom_level = my_bottom_level;
+  graph->attributes[id].marked = 1;
   XBT_DEBUG("%s's bottom level is %f", SD_task_get_name(task), my_bottom_level);
 
-  xbt_dynar_free_container(&children);
   return my_bottom_level ;
 }
 
+/*
+ * Non recursive counterpart of bottom_level_recursive_computation(). The bottom
+ * level of the task is computed from the current bottom levels of its compute
+ * children, that are assumed to be up to date. The value is returned but not
+ * set.
+ */
+double bottom_level_local_computation(SD_task_t task){
+  int i, id = SD_task_get_id(task);
+  double max_bottom_level = -1.0, current_child_bottom_level;
+
+  if (id == graph->end)
+    return 0.0;
+
+  for (i = graph->child_index[id]; i < graph->child_index[id+1]; i++){
+    current_child_bottom_level = SD_task_estimate_child_bottom_level(id, i);
+    if (max_bottom_level < current_child_bottom_level)
+      max_bottom_level = current_child_bottom_level;
+  }
+
+  return SD_task_estimate_execution_time(task,
+      graph->attributes[id].allocation_size) + max_bottom_level;
+}
+
 /* This function is actually not used by biCPA */
 double top_level_recursive_computation(SD_task_t task){
   unsigned int i;
@@ -6,18 +6,204 @@
  * under the terms of the license (GNU LGPL 2.1) which comes with this package.
  *****************************************************************************/
 #include <stdlib.h>
+#include <string.h>
+#include "arena.h"
 #include "workstation.h"
 #include "simdag/simdag.h"
 
+/*
+ * Index of the workstations ordered by availability date. It allows for the
+ * selection of the best workstation set of a task without sorting the whole
+ * list of workstations each time. It is a treap, i.e., a binary search tree on
+ * the (available_at, -id) keys that is also a heap on pseudo-random priorities
+ * derived from the identifiers of the workstations, hence an expected
+ * logarithmic depth. Nodes are workstation identifiers, and the children of
+ * node 'w' are left[w] and right[w] (-1 if none). The keys are duplicated in
+ * 'available_at' to avoid going through SD_workstation_get_data().
+ */
+static int index_root = -1;
+static int *index_left = NULL;
+static int *index_right = NULL;
+static unsigned int *index_priority = NULL;
+static double *index_available_at = NULL;
+
+/* Is the key (avail1, -id1) strictly smaller than the key (avail2, -id2)? */
+static int index_key_less(double avail1, int id1, double avail2, int id2){
+  return (avail1 < avail2) || (avail1 == avail2 && id1 > id2);
+}
+
+/* Split a subtree in the nodes whose keys are smaller than (avail, -id) and
+ * the others */
+static void index_split(int node, double avail, int id, int *left, int *right){
+  if (node < 0){
+    *left = *right = -1;
+  } else if (index_key_less(index_available_at[node], node, avail, id)){
+    index_split(index_right[node], avail, id, &(index_right[node]), right);
+    *left = node;
+  } else {
+    index_split(index_left[node], avail, id, left, &(index_left[node]));
+    *right = node;
+  }
+}
+
+/* Merge two subtrees, all the keys of 'left' being smaller than those of
+ * 'right' */
+static int index_merge(int left, int right){
+  if (left < 0)
+    return right;
+  if (right < 0)
+    return left;
+  if (index_priority[left] > index_priority[right]){
+    index_right[left] = index_merge(index_right[left], right);
+    return left;
+  } else {
+    index_left[right] = index_merge(left, index_left[right]);
+    return right;
+  }
+}
+
+static void index_insert(int id){
+  int left, right;
+
+  index_left[id] = index_right[id] = -1;
+  index_split(index_root, index_available_at[id], id, &left, &right);
+  index_root = index_merge(index_merge(left, id), right);
+}
+
+static int index_remove(int node, int id){
+  if (node == id)
+    return index_merge(index_left[node], index_right[node]);
+  if (index_key_less(index_available_at[id], id, index_available_at[node],
+      node))
+    index_left[node] = index_remove(index_left[node], id);
+  else
+    index_right[node] = index_remove(index_right[node], id);
+  return node;
+}
+
+/* Workstation with the largest key strictly smaller than (avail, -id) */
+static int index_predecessor(double avail, int id){
+  int node = index_root, best = -1;
+
+  while (node >= 0){
+    if (index_key_less(index_available_at[node], node, avail, id)){
+      best = node;
+      node = index_right[node];
+    } else {
+      node = index_left[node];
+    }
+  }
+  return best;
+}
+
+/* Workstation with the smallest key strictly greater than (avail, -id) */
+static int index_successor(double avail, int id){
+  int node = index_root, best = -1;
+
+  while (node >= 0){
+    if (index_key_less(avail, id, index_available_at[node], node)){
+      best = node;
+      node = index_left[node];
+    } else {
+      node = index_right[node];
+    }
+  }
+  return best;
+}
+
+/*
+ * Build the availability index once the attributes of the workstations have
+ * been allocated. It is then maintained by SD_workstation_set_available_at().
+ */
+void build_availability_index(){
+  int i;
+  int nworkstations = SD_workstation_get_number();
+  const SD_workstation_t *workstations = SD_workstation_get_list();
+
+  index_left = (int*) calloc (nworkstations, sizeof(int));
+  index_right = (int*) calloc (nworkstations, sizeof(int));
+  index_priority = (unsigned int*) calloc (nworkstations, sizeof(unsigned int));
+  index_available_at = (double*) calloc (nworkstations, sizeof(double));
+  index_root = -1;
+
+  for (i = 0; i < nworkstations; i++){
+    /* Knuth's multiplicative hash, to get deterministic priorities */
+    index_priority[i] = (unsigned int) (i + 1) * 2654435761u;
+    index_available_at[i] = SD_workstation_get_available_at(workstations[i]);
+    index_insert(i);
+  }
+}
+
+void free_availability_index(){
+  free(index_left);
+  free(index_right);
+  free(index_priority);
+  free(index_available_at);
+  index_left = index_right = NULL;
+  index_priority = NULL;
+  index_available_at = NULL;
+  index_root = -1;
+}
+
 /*****************************************************************************/
 /*****************************************************************************/
 /**************          Attribute management functions         **************/
 /*****************************************************************************/
 /*****************************************************************************/
 
-void SD_workstation_allocate_attribute(SD_workstation_t workstation){
+/*
+ * Snapshot of the attributes of the workstations, taken once the platform is
+ * loaded, and list of the workstations whose attributes have been modified
+ * since they were last restored. Restoring the attributes after a schedule
+ * thus only costs the number of workstations it used.
+ */
+static double *snapshot_available_at = NULL;
+static SD_task_t *snapshot_last_scheduled_task = NULL;
+static int ntouched = 0;
+static int *touched = NULL;
+static int *is_touched = NULL;
+
+static void touch_workstation(int id){
+  if (is_touched && !is_touched[id]){
+    is_touched[id] = 1;
+    touched[ntouched++] = id;
+  }
+}
+
+static void take_workstation_snapshot(){
+  int i;
+  int nworkstations = SD_workstation_get_number();
+  const SD_workstation_t *workstations = SD_workstation_get_list();
+
+  snapshot_available_at = (double*) calloc (nworkstations, sizeof(double));
+  snapshot_last_scheduled_task = (SD_task_t*) calloc (nworkstations,
+      sizeof(SD_task_t));
+  touched = (int*) calloc (nworkstations, sizeof(int));
+  is_touched = (int*) calloc (nworkstations, sizeof(int));
+  ntouched = 0;
+
+  for (i = 0; i < nworkstations; i++){
+    snapshot_available_at[i] = SD_workstation_get_available_at(workstations[i]);
+    snapshot_last_scheduled_task[i] =
+        SD_workstation_get_last_scheduled_task(workstations[i]);
+  }
+}
+
+static void free_workstation_snapshot(){
+  free(snapshot_available_at);
+  free(snapshot_last_scheduled_task);
+  free(touched);
+  free(is_touched);
+  snapshot_available_at = NULL;
+  snapshot_last_scheduled_task = NULL;
+  touched = is_touched = NULL;
+  ntouched = 0;
+}
+
+void SD_workstation_allocate_attribute(SD_workstation_t workstation, int id){
   WorkstationAttribute data;
   data = calloc(1,sizeof(struct _WorkstationAttribute));
+  data->id = id;
   SD_workstation_set_data(workstation, data);
 }
 
@@ -26,6 +212,12 @@ void SD_workstation_free_attribute(SD_workstation_t workstation){
   SD_workstation_set_data(workstation, NULL);
 }
 
+int SD_workstation_get_id(SD_workstation_t workstation){
+  WorkstationAttribute attr =
+    (WorkstationAttribute) SD_workstation_get_data(workstation);
+  return attr->id;
+}
+
 double SD_workstation_get_available_at( SD_workstation_t workstation){
   WorkstationAttribute attr =
     (WorkstationAttribute) SD_workstation_get_data(workstation);
@@ -35,8 +227,18 @@ double SD_workstation_get_available_at( SD_workstation_t workstation){
 void SD_workstation_set_available_at(SD_workstation_t workstation, double time){
   WorkstationAttribute attr =
     (WorkstationAttribute) SD_workstation_get_data(workstation);
+  if (attr->available_at == time)
+    return;
+  touch_workstation(attr->id);
   attr->available_at=time;
   SD_workstation_set_data(workstation, attr);
+
+  /* Move the workstation at its new place in the availability index */
+  if (index_available_at){
+    index_root = index_remove(index_root, attr->id);
+    index_available_at[attr->id] = time;
+    index_insert(attr->id);
+  }
 }
 
 SD_task_t SD_workstation_get_last_scheduled_task( SD_workstation_t workstation){
@@ -49,14 +251,60 @@ void SD_workstation_set_last_scheduled_task(SD_workstation_t workstation,
                                             SD_task_t task){
   WorkstationAttribute attr =
     (WorkstationAttribute) SD_workstation_get_data(workstation);
+  touch_workstation(attr->id);
   attr->last_scheduled_task=task;
   SD_workstation_set_data(workstation, attr);
 }
 
 /*
- * Used to start a new simulation within the same run on the fresh basis.
- * This function browses the list of workstations and set back attributes to
- * their initial values:
+ * Create the simulation environment from a platform file, sort its
+ * workstations by name, and allocate their attributes. The identifier of a
+ * workstation is its index in the sorted list. The availability index and the
+ * route cache are then built for this platform.
+ */
+void load_platform(const char *file){
+  int i, nworkstations;
+  const SD_workstation_t *workstations;
+
+  SD_create_environment(file);
+  nworkstations = SD_workstation_get_number();
+  workstations = SD_workstation_get_list();
+
+  /* Sort the hosts by name for sake of simplicity */
+  qsort((void *)workstations, nworkstations, sizeof(SD_workstation_t),
+      nameCompareWorkstations);
+
+  for (i = 0; i < nworkstations; i++)
+    SD_workstation_allocate_attribute(workstations[i], i);
+
+  build_availability_index();
+  build_route_cache();
+  take_workstation_snapshot();
+}
+
+/*
+ * Release the state built for the platform, and the chunks kept by the arenas,
+ * as no DAG is scheduled on the platform anymore.
+ */
+void free_platform(){
+  int i;
+  int nworkstations = SD_workstation_get_number();
+  const SD_workstation_t *workstations = SD_workstation_get_list();
+
+  free_availability_index();
+  free_route_cache();
+  free_workstation_snapshot();
+  free_gap_index();
+  for (i = 0; i < nworkstations; i++)
+    SD_workstation_free_attribute(workstations[i]);
+  arena_free(&schedule_arena);
+  arena_free(&dag_arena);
+}
+
+/*
+ * Used to start on a fresh basis once a DAG is freed, so that another DAG can
+ * be scheduled on the same platform. This function browses the list of all the
+ * workstations and set back attributes to their initial values:
  *   - available_at = 0.0
  *   - last_scheduled_task = NULL
  */
@@ -69,6 +317,30 @@ void reset_workstation_attributes() {
     SD_workstation_set_available_at(workstations[i], 0.0);
     SD_workstation_set_last_scheduled_task(workstations[i], NULL);
   }
+  for (i = 0; i < ntouched; i++)
+    is_touched[touched[i]] = 0;
+  ntouched = 0;
+}
+
+/*
+ * Used between the schedules of a DAG. Only the attributes of the workstations
+ * modified since the last restoration are set back to their values in the
+ * snapshot of the platform. The flags of these workstations are kept until the
+ * end, so that they are not recorded again.
+ */
+void restore_workstation_attributes() {
+  int i;
+  const SD_workstation_t *workstations = SD_workstation_get_list();
+
+  for (i = 0; i < ntouched; i++){
+    SD_workstation_set_available_at(workstations[touched[i]],
+        snapshot_available_at[touched[i]]);
+    SD_workstation_set_last_scheduled_task(workstations[touched[i]],
+        snapshot_last_scheduled_task[touched[i]]);
+  }
+  for (i = 0; i < ntouched; i++)
+    is_touched[touched[i]] = 0;
+  ntouched = 0;
 }
 
 /*****************************************************************************/
@@ -85,47 +357,6 @@ int nameCompareWorkstations(const void *w1, const void *w2){
       SD_workstation_get_name(*((SD_workstation_t *)w2)));
 }
 
-/*
- * When determining what is the 'best' workstation set to execute a given, the
- * rationale is to sort the whole set with regard to the estimated minimal start
- * time of the considered task and the availability dates of the workstations.
- * All the workstations that are available before this minimal start are sorted
- * in decreasing order of available_at values and placed at the beginning of the
- * set. Those that are available after are sorted in increasing order of
- * available_at values and placed at the end of the set. This way idle times are
- * minimize, and the earliest available workstations are selected, whether the
- * task has to wait or not.
- * The two functions below sorts workstations according to the values of the
- * available_at attribute, in decreasing and increasing order respectively.
- */
-int availableAtCompareWorkstations(const void *n1, const void *n2) {
-  double avail1, avail2;
-
-  avail1 = SD_workstation_get_available_at(*((SD_workstation_t*)n1));
-  avail2 = SD_workstation_get_available_at(*((SD_workstation_t*)n2));
-
-  if (avail1 > avail2)
-    return -1;
-  else if (avail1 == avail2)
-    return 0;
-  else
-    return 1;
-}
-
-int NavailableAtCompareWorkstations(const void *n1, const void *n2) {
-  double avail1, avail2;
-
-  avail1 = SD_workstation_get_available_at(*((SD_workstation_t*)n1));
-  avail2 = SD_workstation_get_available_at(*((SD_workstation_t*)n2));
-
-  if (avail1 < avail2)
-    return -1;
-  else if (avail1 == avail2)
-    return 0;
-  else
-    return 1;
-}
-
 /*****************************************************************************/
 /*****************************************************************************/
 /**************               Accounting functions              **************/
@@ -150,43 +381,40 @@ int compute_peak_resource_usage() {
   return peak;
 }
 /*
- * Sort the global list workstations with regard to their availability dates and
- * the simulated time given as input (that corresponds to the estimated minimal
- * start time of a task).
- * All the workstations that are available before this minimal start are sorted
- * in decreasing order of available_at values and placed at the beginning of the
- * set. Those that are available after are sorted in increasing order of
- * available_at values and placed at the end of the set. This way idle times are
- * minimize, and the earliest available workstations are selected, whether the
- * task has to wait or not.
+ * Select the 'nworkstations' best workstations with regard to their
+ * availability dates and the simulated time given as input (that corresponds to
+ * the estimated minimal start time of a task).
+ * The workstations that are available before this minimal start are taken
+ * first, in decreasing order of available_at values. Then, if needed, those
+ * that are available after are taken in increasing order of available_at
+ * values. This way idle times are minimize, and the earliest available
+ * workstations are selected, whether the task has to wait or not.
+ * Workstations are read in this order from the availability index, starting
+ * from the key (time, +inf) and moving backwards, then forwards. Workstations
+ * with equal availability dates are thus taken by increasing identifiers among
+ * those available before 'time', and by decreasing identifiers among the others,
+ * so that the selected set does not depend on the sorting algorithm.
+ * The set is taken from the arena of the current schedule.
  */
-SD_workstation_t * get_best_workstation_set(double time){
-  int i, nfirst=0;
-  int nworkstations = SD_workstation_get_number();
+SD_workstation_t * get_best_workstation_set(double time, int nworkstations){
+  int w, k = 0;
   const SD_workstation_t *workstations = SD_workstation_get_list();
   SD_workstation_t *best_workstation_set = NULL;
 
-  best_workstation_set = (SD_workstation_t*) calloc (nworkstations,
-      sizeof(SD_workstation_t));
+  best_workstation_set = (SD_workstation_t*) arena_alloc(&schedule_arena,
+      nworkstations * sizeof(SD_workstation_t));
 
-  for (i = 0; i < nworkstations; i++){
-    if (SD_workstation_get_available_at(workstations[i]) > time){
-      best_workstation_set[nworkstations-nfirst-1] = workstations[i];
-      nfirst++;
-    } else {
-      best_workstation_set[i - nfirst] = workstations[i];
-    }
-  }
+  /* Hosts that are available before the end of node's parent, in a
+   * decreasing order w.r.t. their availability date */
+  for (w = index_predecessor(time, -1); w >= 0 && k < nworkstations;
+      w = index_predecessor(index_available_at[w], w))
+    best_workstation_set[k++] = workstations[w];
 
-  /* Order hosts that are available before the end of node's parent
-   * in a decreasing order w.r.t. their availability date*/
-  qsort(best_workstation_set,nworkstations-nfirst,sizeof(SD_workstation_t),
-      availableAtCompareWorkstations);
-
-  /* Order hosts that are available after the end of node's parent
-   * in a increasing order w.r.t. their availability date */
-  qsort(&(best_workstation_set[nworkstations-nfirst]), nfirst,
-      sizeof(SD_workstation_t), NavailableAtCompareWorkstations);
+  /* Hosts that are available after the end of node's parent, in a
+   * increasing order w.r.t. their availability date */
+  for (w = index_successor(time, -1); w >= 0 && k < nworkstations;
+      w = index_successor(index_available_at[w], w))
+    best_workstation_set[k++] = workstations[w];
 
   return best_workstation_set;
 }
@@ -205,3 +433,445 @@ double get_best_workstation_set_earliest_availability(int nworkstations,
       max_availability = SD_workstation_get_available_at(workstations[i]);
   return max_availability;
 }
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************                 Idle-gap index                  **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/*
+ * With backfilling, the idle periods left between the tasks mapped on a
+ * workstation are recorded as gaps, with the tasks mapped just before and
+ * after them (NULL if none). The last idle period of a workstation, from its
+ * availability date on, is not a gap: it is given by the availability index.
+ * Gaps are the nodes of a treap ordered by (start, rank of creation). Each
+ * node also keeps the latest end and the longest length of the gaps of its
+ * subtree, so that the subtrees where no gap can hold a task are pruned.
+ * Gaps are taken from the arena of the current schedule.
+ */
+typedef struct _Gap *Gap;
+struct _Gap {
+  int workstation;
+  double start;
+  double end;
+  SD_task_t before;
+  SD_task_t after;
+
+  unsigned int rank;
+  unsigned int priority;
+  Gap left;
+  Gap right;
+  double max_end;
+  double max_length;
+};
+
+static Gap gap_root = NULL;
+static unsigned int ngaps = 0;
+/* Gaps that may hold the task being mapped, grown as needed */
+static Gap *found_gaps = NULL;
+static Gap *expiring_gaps = NULL;
+static int nfound_gaps = 0;
+static int found_gaps_size = 0;
+/* Gaps of the workstations of the last selected set (NULL if not in a gap) */
+static Gap *selected_gaps = NULL;
+
+static int gap_key_less(Gap gap1, Gap gap2){
+  return (gap1->start < gap2->start) ||
+      (gap1->start == gap2->start && gap1->rank < gap2->rank);
+}
+
+static void gap_update(Gap gap){
+  gap->max_end = gap->end;
+  gap->max_length = gap->end - gap->start;
+  if (gap->left){
+    gap->max_end = MAX(gap->max_end, gap->left->max_end);
+    gap->max_length = MAX(gap->max_length, gap->left->max_length);
+  }
+  if (gap->right){
+    gap->max_end = MAX(gap->max_end, gap->right->max_end);
+    gap->max_length = MAX(gap->max_length, gap->right->max_length);
+  }
+}
+
+static void gap_split(Gap node, Gap gap, Gap *left, Gap *right){
+  if (!node){
+    *left = *right = NULL;
+    return;
+  }
+  if (gap_key_less(node, gap)){
+    gap_split(node->right, gap, &(node->right), right);
+    *left = node;
+  } else {
+    gap_split(node->left, gap, left, &(node->left));
+    *right = node;
+  }
+  gap_update(node);
+}
+
+static Gap gap_merge(Gap left, Gap right){
+  if (!left)
+    return right;
+  if (!right)
+    return left;
+  if (left->priority > right->priority){
+    left->right = gap_merge(left->right, right);
+    gap_update(left);
+    return left;
+  } else {
+    right->left = gap_merge(left, right->left);
+    gap_update(right);
+    return right;
+  }
+}
+
+static void gap_insert(int workstation, double start, double end,
+    SD_task_t before, SD_task_t after){
+  Gap gap, left, right;
+
+  if (end <= start)
+    return;
+  gap = (Gap) arena_alloc(&schedule_arena, sizeof(struct _Gap));
+  gap->workstation = workstation;
+  gap->start = start;
+  gap->end = end;
+  gap->before = before;
+  gap->after = after;
+  gap->rank = ngaps++;
+  gap->priority = gap->rank * 2654435761u + 1;
+  gap_update(gap);
+
+  gap_split(gap_root, gap, &left, &right);
+  gap_root = gap_merge(gap_merge(left, gap), right);
+}
+
+static Gap gap_remove(Gap node, Gap gap){
+  if (node == gap)
+    return gap_merge(node->left, node->right);
+  if (gap_key_less(gap, node))
+    node->left = gap_remove(node->left, gap);
+  else
+    node->right = gap_remove(node->right, gap);
+  gap_update(node);
+  return node;
+}
+
+/*
+ * Record the gaps where a task of the given duration can start between 'time'
+ * and 'limit', i.e., at max(start, time). The gaps are browsed by increasing
+ * start, and subtrees whose gaps all end too early or are too short are
+ * skipped.
+ */
+static void gap_collect(Gap node, double time, double limit, double duration){
+  double start;
+
+  if (!node || node->max_length < duration || node->max_end <= time ||
+      node->max_end < time + duration)
+    return;
+  gap_collect(node->left, time, limit, duration);
+  if (node->start >= limit)
+    return;
+  start = MAX(node->start, time);
+  if (start < node->end && start + duration <= node->end){
+    if (nfound_gaps == found_gaps_size){
+      found_gaps_size = found_gaps_size ? 2 * found_gaps_size : 64;
+      found_gaps = (Gap*) realloc (found_gaps, found_gaps_size * sizeof(Gap));
+      expiring_gaps = (Gap*) realloc (expiring_gaps,
+          found_gaps_size * sizeof(Gap));
+    }
+    found_gaps[nfound_gaps++] = node;
+  }
+  gap_collect(node->right, time, limit, duration);
+}
+
+static int endCompareGaps(const void *g1, const void *g2){
+  Gap gap1 = *((Gap*) g1), gap2 = *((Gap*) g2);
+
+  if (gap1->end < gap2->end)
+    return -1;
+  if (gap1->end > gap2->end)
+    return 1;
+  return gap1->rank < gap2->rank ? -1 : (gap1->rank > gap2->rank);
+}
+
+/* Best fit: shortest gaps first, ties broken by workstation identifiers */
+static int lengthCompareGaps(const void *g1, const void *g2){
+  Gap gap1 = *((Gap*) g1), gap2 = *((Gap*) g2);
+  double length1 = gap1->end - gap1->start, length2 = gap2->end - gap2->start;
+
+  if (length1 < length2)
+    return -1;
+  if (length1 > length2)
+    return 1;
+  return gap1->workstation - gap2->workstation;
+}
+
+/* Can a task of the given duration no longer start in the gap at 'time'? */
+static int gap_is_expired(Gap gap, double time, double duration){
+  return (time >= gap->end) || (time + duration > gap->end);
+}
+
+/*
+ * Start a new schedule without any gap. The former gaps were released with the
+ * arena of the previous schedule.
+ */
+void reset_gap_index(){
+  gap_root = NULL;
+  ngaps = 0;
+}
+
+void free_gap_index(){
+  free(found_gaps);
+  free(expiring_gaps);
+  found_gaps = expiring_gaps = NULL;
+  nfound_gaps = found_gaps_size = 0;
+  reset_gap_index();
+}
+
+/*
+ * Backfilling version of get_best_workstation_set(). Without gaps, the set
+ * selected by get_best_workstation_set() can be used from the availability
+ * date of its last workstation, that bounds the search ('limit'). The earliest
+ * date 'start' before this bound where 'nworkstations' workstations are idle
+ * for 'duration' is looked for among 'time' and the starts of the gaps that
+ * may hold the task. At each candidate date, the idle workstations are those
+ * available for good, read from the availability index, and those in a gap
+ * that started and did not expire yet. The gaps are swept by increasing start
+ * and end, which gives this number without browsing all the workstations.
+ * The selected set takes the shortest gaps first, then the workstations
+ * available for good, latest first, as get_best_workstation_set() does.
+ * The date from which the set is available is returned in 'start'. 'in_gaps'
+ * tells whether the set is only available for a limited time, i.e., whether
+ * the task must start at 'start' exactly. The gaps of the set are kept for
+ * backfill_workstation_set().
+ */
+SD_workstation_t *get_backfilling_workstation_set(double time,
+    int nworkstations, double duration, double *start, int *in_gaps){
+  int w, i, k = 0, nbefore = 0, nlater = 0, nstarted = 0, nexpired = 0;
+  int navailable;
+  double limit = time, candidate = time;
+  const SD_workstation_t *workstations = SD_workstation_get_list();
+  SD_workstation_t *set;
+
+  selected_gaps = (Gap*) arena_alloc(&schedule_arena,
+      nworkstations * sizeof(Gap));
+  *in_gaps = 0;
+
+  /* Workstations available for good before 'time', and the availability date
+   * of the set selected by get_best_workstation_set() */
+  for (w = index_predecessor(time, -1); w >= 0 && nbefore < nworkstations;
+      w = index_predecessor(index_available_at[w], w))
+    nbefore++;
+  for (w = index_successor(time, -1);
+      w >= 0 && nbefore + nlater < nworkstations;
+      w = index_successor(index_available_at[w], w)){
+    limit = index_available_at[w];
+    nlater++;
+  }
+
+  nfound_gaps = 0;
+  if (nbefore < nworkstations)
+    gap_collect(gap_root, time, limit, duration);
+
+  if (!nfound_gaps){
+    set = get_best_workstation_set(time, nworkstations);
+    *start = MAX(time,
+        get_best_workstation_set_earliest_availability(nworkstations, set));
+    return set;
+  }
+
+  /* Sweep the candidate dates. The found gaps are sorted by increasing start
+   * by construction */
+  memcpy(expiring_gaps, found_gaps, nfound_gaps * sizeof(Gap));
+  qsort(expiring_gaps, nfound_gaps, sizeof(Gap), endCompareGaps);
+  w = index_successor(time, -1);
+  navailable = nbefore;
+  for (i = -1; i < nfound_gaps; i++){
+    candidate = (i < 0) ? time : MAX(found_gaps[i]->start, time);
+    while (w >= 0 && index_available_at[w] <= candidate){
+      navailable++;
+      w = index_successor(index_available_at[w], w);
+    }
+    while (nstarted < nfound_gaps &&
+        MAX(found_gaps[nstarted]->start, time) <= candidate)
+      nstarted++;
+    while (nexpired < nfound_gaps &&
+        gap_is_expired(expiring_gaps[nexpired], candidate, duration))
+      nexpired++;
+    if (navailable + nstarted - nexpired >= nworkstations)
+      break;
+  }
+
+  if (i == nfound_gaps){
+    set = get_best_workstation_set(time, nworkstations);
+    *start = MAX(time,
+        get_best_workstation_set_earliest_availability(nworkstations, set));
+    return set;
+  }
+
+  /* Gaps idle at the selected date, shortest first */
+  nstarted = 0;
+  for (i = 0; i < nfound_gaps; i++)
+    if (MAX(found_gaps[i]->start, time) <= candidate &&
+        !gap_is_expired(found_gaps[i], candidate, duration))
+      found_gaps[nstarted++] = found_gaps[i];
+  qsort(found_gaps, nstarted, sizeof(Gap), lengthCompareGaps);
+
+  set = (SD_workstation_t*) arena_alloc(&schedule_arena,
+      nworkstations * sizeof(SD_workstation_t));
+  for (i = 0; i < nstarted && k < nworkstations; i++){
+    selected_gaps[k] = found_gaps[i];
+    set[k++] = workstations[found_gaps[i]->workstation];
+  }
+  for (w = index_predecessor(candidate, -1); w >= 0 && k < nworkstations;
+      w = index_predecessor(index_available_at[w], w))
+    set[k++] = workstations[w];
+
+  *start = candidate;
+  *in_gaps = 1;
+  return set;
+}
+
+/*
+ * Map a task on the set returned by the last call to
+ * get_backfilling_workstation_set(), from 'start' to 'finish'. The gap filled
+ * on a workstation is replaced by what remains before and after the task. On a
+ * workstation available for good, the idle time before the task becomes a
+ * gap, and the task becomes the last one. The tasks between which the task is
+ * inserted on each workstation are returned in 'before' and 'after' (NULL if
+ * none), to order the tasks in the simulation.
+ */
+void backfill_workstation_set(SD_task_t task, int nworkstations,
+    SD_workstation_t *workstations, double start, double finish,
+    SD_task_t *before, SD_task_t *after){
+  int i, id;
+  Gap gap;
+
+  for (i = 0; i < nworkstations; i++){
+    id = SD_workstation_get_id(workstations[i]);
+    gap = selected_gaps[i];
+    if (gap){
+      before[i] = gap->before;
+      after[i] = gap->after;
+      gap_root = gap_remove(gap_root, gap);
+      gap_insert(id, gap->start, start, gap->before, task);
+      gap_insert(id, finish, gap->end, task, gap->after);
+    } else {
+      before[i] = SD_workstation_get_last_scheduled_task(workstations[i]);
+      after[i] = NULL;
+      gap_insert(id, SD_workstation_get_available_at(workstations[i]), start,
+          before[i], task);
+      SD_workstation_set_available_at(workstations[i], finish);
+      SD_workstation_set_last_scheduled_task(workstations[i], task);
+    }
+  }
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/**************                   Route cache                   **************/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/*
+ * Summaries of the routes between the pairs of workstations used by the
+ * schedules, in an open addressing table keyed by src * P + dst, where P is the
+ * number of workstations. A summary is computed the first time its route is
+ * needed, so that the size of the cache grows with the number of pairs actually
+ * used, instead of P^2 (about 2.7 GB for 8192 workstations). The table is
+ * doubled when it is half full, hence a summary returned by get_route_summary()
+ * is only valid until the next call.
+ */
+#define ROUTE_CACHE_INITIAL_SIZE 1024
+
+typedef struct _RouteCacheEntry {
+  long key;
+  struct _RouteSummary summary;
+} RouteCacheEntry;
+
+static RouteCacheEntry *route_cache = NULL;
+static long route_cache_size = 0;
+static long route_cache_count = 0;
+
+static RouteCacheEntry *route_cache_alloc(long size){
+  long i;
+  RouteCacheEntry *table = (RouteCacheEntry*) malloc (size *
+      sizeof(RouteCacheEntry));
+
+  for (i = 0; i < size; i++)
+    table[i].key = -1;
+  return table;
+}
+
+void build_route_cache(){
+  route_cache_size = ROUTE_CACHE_INITIAL_SIZE;
+  route_cache_count = 0;
+  route_cache = route_cache_alloc(route_cache_size);
+}
+
+void free_route_cache(){
+  free(route_cache);
+  route_cache = NULL;
+  route_cache_size = route_cache_count = 0;
+}
+
+/* Slot of 'key' in the table, or of the empty entry where to insert it */
+static long route_cache_slot(const RouteCacheEntry *table, long size,
+    long key){
+  unsigned long hash = (unsigned long) key * 11400714819323198485UL;
+  long k = (long) ((hash ^ (hash >> 32)) & (size - 1));
+
+  while (table[k].key >= 0 && table[k].key != key)
+    k = (k + 1) & (size - 1);
+  return k;
+}
+
+static void grow_route_cache(){
+  long i, size = 2 * route_cache_size;
+  RouteCacheEntry *table = route_cache_alloc(size);
+
+  for (i = 0; i < route_cache_size; i++)
+    if (route_cache[i].key >= 0)
+      table[route_cache_slot(table, size, route_cache[i].key)] =
+          route_cache[i];
+  free(route_cache);
+  route_cache = table;
+  route_cache_size = size;
+}
+
+static void fill_route_summary(int src, int dst, RouteSummary summary){
+  int i;
+  const SD_workstation_t *workstations = SD_workstation_get_list();
+  const SD_link_t *route;
+
+  memset(summary, 0, sizeof(struct _RouteSummary));
+  route = SD_route_get_list(workstations[src], workstations[dst]);
+  summary->nlinks = SD_route_get_size(workstations[src], workstations[dst]);
+  summary->latency = SD_route_get_current_latency(workstations[src],
+      workstations[dst]);
+  if (!summary->nlinks)
+    return;
+  summary->first_bandwidth = SD_link_get_current_bandwidth(route[0]);
+  summary->last_bandwidth =
+      SD_link_get_current_bandwidth(route[summary->nlinks - 1]);
+  for (i = 1; i < summary->nlinks - 1; i++)
+    if (!summary->middle_bandwidth ||
+        SD_link_get_current_bandwidth(route[i]) < summary->middle_bandwidth)
+      summary->middle_bandwidth = SD_link_get_current_bandwidth(route[i]);
+}
+
+RouteSummary get_route_summary(int src, int dst){
+  long key = (long) src * SD_workstation_get_number() + dst;
+  long k = route_cache_slot(route_cache, route_cache_size, key);
+
+  if (route_cache[k].key < 0){
+    if (2 * (route_cache_count + 1) > route_cache_size){
+      grow_route_cache();
+      k = route_cache_slot(route_cache, route_cache_size, key);
+    }
+    route_cache[k].key = key;
+    fill_route_summary(src, dst, &(route_cache[k].summary));
+    route_cache_count++;
+  }
+  return &(route_cache[k].summary);
+}